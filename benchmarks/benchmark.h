@@ -0,0 +1,61 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Shared helpers of the runtime benchmarks: wall clock timing of a repeated
+// operation, printed as one line per case.
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+namespace benchmark
+{
+	// seconds taken by f()
+	template<class F>
+	double seconds(F&& f)
+	{
+		auto start = std::chrono::steady_clock::now();
+		f();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// prints "<name>  <total ms>  <ns per operation>  <operations per second>"
+	inline void report(const char* name, double seconds, double operations)
+	{
+		std::printf("%-40s %10.3f ms %10.1f ns/op %14.0f op/s\n", name, seconds * 1e3,
+			seconds * 1e9 / operations, operations / seconds);
+	}
+
+	// keeps the compiler from dropping a computed value
+	template<class T>
+	void keep(const T& value)
+	{
+		static volatile const T* sink;
+		sink = &value;
+	}
+}
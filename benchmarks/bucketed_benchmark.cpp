@@ -0,0 +1,180 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Event vs BucketedEvent for large fan-outs of a few callable types: notify
+// time per callback and, on Linux when perf events are allowed
+// (kernel.perf_event_paranoid <= 2), branch misses and instructions per
+// callback, read from the hardware counters.
+//
+// bucketed_benchmark, built with PICOEVENTS_BUILD_BENCHMARKS
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "picoevents_bucketed.h"
+#include "benchmark.h"
+
+namespace
+{
+	// a hardware counter of the calling thread, unavailable (-1) when not allowed
+	class Counter
+	{
+	public:
+		enum Kind { BranchMisses, Instructions };
+
+		explicit Counter(Kind kind)
+		{
+#if defined(__linux__)
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = kind == BranchMisses ? PERF_COUNT_HW_BRANCH_MISSES : PERF_COUNT_HW_INSTRUCTIONS;
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+			(void)kind;
+#endif
+		}
+		Counter(const Counter&) = delete;
+		Counter& operator=(const Counter&) = delete;
+		~Counter()
+		{
+#if defined(__linux__)
+			if (_fd >= 0) close(_fd);
+#endif
+		}
+		bool available() const
+		{
+			return _fd >= 0;
+		}
+		void start()
+		{
+#if defined(__linux__)
+			if (_fd < 0) return;
+			ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+		}
+		uint64_t stop()
+		{
+			uint64_t value = 0;
+#if defined(__linux__)
+			if (_fd < 0) return 0;
+			ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(_fd, &value, sizeof(value)) != sizeof(value)) value = 0;
+#endif
+			return value;
+		}
+
+	private:
+		int _fd = -1;
+	};
+
+	struct Sprite
+	{
+		float x = 0;
+	};
+
+	// K different closure types, as K kinds of subscribers would be
+	template<int K>
+	auto updater(Sprite& s)
+	{
+		return [&s](float dt) { s.x += dt * (K + 1); };
+	}
+
+	template<typename E, size_t... K>
+	void addAll(E& event, std::vector<Sprite>& sprites, std::index_sequence<K...>)
+	{
+		using Add = void (*)(E&, Sprite&);
+		const Add adds[] = { [](E& e, Sprite& s) { e.add(updater<(int)K>(s)); }... };
+		for (size_t i = 0; i < sprites.size(); i++) adds[i % sizeof...(K)](event, sprites[i]);
+	}
+
+	template<typename E>
+	void measure(const char* kind, E& event, size_t callbacks, size_t types)
+	{
+		const int notifications = 200;
+		Counter misses(Counter::BranchMisses);
+		Counter instructions(Counter::Instructions);
+		event.notify(0.f);
+		misses.start();
+		instructions.start();
+		double t = benchmark::seconds([&] { for (int i = 0; i < notifications; i++) event.notify(0.016f); });
+		uint64_t m = misses.stop();
+		uint64_t n = instructions.stop();
+
+		char name[64];
+		std::snprintf(name, sizeof(name), "%s, %zu callbacks, %zu types", kind, callbacks, types);
+		double calls = (double)callbacks * notifications;
+		std::printf("%-40s %8.2f ns/callback", name, t * 1e9 / calls);
+		if (misses.available()) std::printf("  %6.3f branch misses/callback  %6.1f instructions/callback", m / calls, n / calls);
+		std::printf("\n");
+	}
+
+	template<size_t Types>
+	void run(size_t callbacks)
+	{
+		std::vector<Sprite> sprites(callbacks);
+		{
+			picoevents::Event<float> event;
+			addAll(event, sprites, std::make_index_sequence<Types>());
+			measure("Event", event, callbacks, Types);
+		}
+		{
+			picoevents::BucketedEvent<float> event;
+			addAll(event, sprites, std::make_index_sequence<Types>());
+			measure("BucketedEvent", event, callbacks, Types);
+		}
+		float sum = 0;
+		for (auto& s : sprites) sum += s.x;
+		benchmark::keep(sum);
+	}
+}
+
+int main()
+{
+	if (!Counter(Counter::BranchMisses).available())
+		std::printf("no hardware counters (perf_event_open refused or not Linux), times only\n");
+	for (size_t callbacks : { 1000, 10000, 100000 })
+	{
+		run<1>(callbacks);
+		run<4>(callbacks);
+		run<16>(callbacks);
+	}
+	return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Measures what PICOEVENTS_EXTERN_TEMPLATES and PICOEVENTS_SEPARATE_CORE save:
+// generates a corpus of translation units using the common Event signatures,
+// compiles it header only, then with both defines (and picoevents.cpp), and
+// prints the compile times and object sizes.
+//
+// build_times <compiler> <picoevents directory> <output directory> [units] [compiler flags]
+// run by the picoevents_build_times target (PICOEVENTS_BUILD_BENCHMARKS),
+// for compilers taking GCC-style options
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	namespace fs = std::filesystem;
+
+	// a widget with the four common signatures and a Value, as an application would have
+	void writeUnit(const fs::path& path, int i)
+	{
+		std::ofstream f(path);
+		f << "#include <string>\n"
+			"#include \"picoevents.h\"\n\n"
+			"namespace unit" << i << "\n{\n"
+			"\tstruct Widget\n\t{\n"
+			"\t\tpicoevents::Event<> clicked;\n"
+			"\t\tpicoevents::Event<int> moved;\n"
+			"\t\tpicoevents::Event<bool> toggled;\n"
+			"\t\tpicoevents::Event<const std::string&> renamed;\n"
+			"\t\tpicoevents::Value<int> level { 0 };\n"
+			"\t};\n}\n\n"
+			"int corpus" << i << "(int v, const std::string& name)\n{\n"
+			"\tunit" << i << "::Widget w;\n"
+			"\tint sum = 0;\n"
+			"\tw.clicked.add([&sum] { sum++; });\n"
+			"\tw.moved.add([&sum](int x) { sum += x + " << i << "; });\n"
+			"\tw.toggled.add([&sum](bool b) { sum += b; }, true);\n"
+			"\tw.renamed.add([&sum](const std::string& s) { sum += (int)s.size(); });\n"
+			"\tw.level.addListener([&sum](int l) { sum -= l; });\n"
+			"\tpicoevents::Event<int>::ScopedCallbackID scoped(w.moved, [&sum](int x) { sum ^= x; });\n"
+			"\tw.clicked.notify();\n"
+			"\tw.moved.notify(v);\n"
+			"\tw.toggled.makeNotifier(v > 0).trigger();\n"
+			"\tw.renamed.notify(name);\n"
+			"\tw.level.set(v);\n"
+			"\treturn sum;\n}\n";
+	}
+
+	struct Result
+	{
+		double seconds = 0;
+		uintmax_t bytes = 0;
+		bool ok = true;
+	};
+
+	Result compile(const std::string& command, const std::vector<fs::path>& sources, const fs::path& out)
+	{
+		Result r;
+		fs::create_directories(out);
+		auto start = std::chrono::steady_clock::now();
+		for (const fs::path& source : sources)
+		{
+			fs::path object = out / source.filename().replace_extension(".o");
+			std::string line = command + " -c \"" + source.string() + "\" -o \"" + object.string() + "\"";
+			if (std::system(line.c_str()) != 0)
+			{
+				fprintf(stderr, "failed: %s\n", line.c_str());
+				r.ok = false;
+				return r;
+			}
+			r.bytes += fs::file_size(object);
+		}
+		r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return r;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		fprintf(stderr, "usage: build_times <compiler> <picoevents directory> <output directory> [units] [compiler flags]\n");
+		return 2;
+	}
+	std::string compiler = argv[1];
+	fs::path root = argv[2];
+	fs::path out = argv[3];
+	int units = argc > 4 ? std::atoi(argv[4]) : 20;
+	std::string flags = argc > 5 ? argv[5] : "-O2";
+
+	fs::create_directories(out / "corpus");
+	std::vector<fs::path> sources;
+	for (int i = 0; i < units; i++)
+	{
+		sources.push_back(out / "corpus" / ("unit" + std::to_string(i) + ".cpp"));
+		writeUnit(sources.back(), i);
+	}
+
+	std::string base = "\"" + compiler + "\" -std=c++17 " + flags + " -I\"" + root.string() + "\"";
+	Result headerOnly = compile(base, sources, out / "header_only");
+	std::string defines = " -DPICOEVENTS_EXTERN_TEMPLATES -DPICOEVENTS_SEPARATE_CORE";
+	Result separate = compile(base + defines, sources, out / "separate");
+	// what the corpus compiles once instead
+	Result once = compile(base + defines, { root / "picoevents.cpp" }, out / "separate");
+	if (!headerOnly.ok || !separate.ok || !once.ok) return 1;
+
+	printf("%d translation units, %s\n", units, flags.c_str());
+	printf("%-44s %10s %12s %14s\n", "", "seconds", "ms per unit", "object bytes");
+	printf("%-44s %10.2f %12.1f %14ju\n", "header only", headerOnly.seconds, 1000 * headerOnly.seconds / units, headerOnly.bytes);
+	printf("%-44s %10.2f %12.1f %14ju\n", "EXTERN_TEMPLATES + SEPARATE_CORE", separate.seconds, 1000 * separate.seconds / units, separate.bytes);
+	printf("%-44s %10.2f %12s %14ju\n", "  + picoevents.cpp", once.seconds, "", once.bytes);
+	printf("saved: %.1f%% compile time, %.1f%% object size\n",
+		100 * (1 - (separate.seconds + once.seconds) / headerOnly.seconds),
+		100 * (1 - double(separate.bytes + once.bytes) / double(headerOnly.bytes)));
+	return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Channel throughput between two threads, in messages per second, for a few
+// capacities and consumer batch sizes, with the consumer polling
+// (yielding when the ring is empty, Wakeup::None) or blocking in wait()
+// (Wakeup::Notify).
+//
+// channel_benchmark, built with PICOEVENTS_BUILD_BENCHMARKS
+
+#include <thread>
+
+#include "picoevents_channel.h"
+#include "benchmark.h"
+
+namespace
+{
+	using Frames = picoevents::Channel<int, float>;
+
+	void run(size_t capacity, size_t batch, Frames::Wakeup wakeup)
+	{
+		const int count = 2000000;
+		Frames channel(capacity, wakeup);
+		double sum = 0;
+		double t = benchmark::seconds([&] {
+			std::thread producer([&channel] {
+				for (int i = 0; i < count; i++) channel.push(i, 0.5f);
+			});
+			int received = 0;
+			while (received < count)
+			{
+				if (wakeup == Frames::Wakeup::Notify) channel.wait();
+				size_t n = channel.consume([&sum](int i, float f) { sum += i * f; }, batch);
+				if (!n) std::this_thread::yield();
+				received += (int)n;
+			}
+			producer.join();
+		});
+		char name[64];
+		std::snprintf(name, sizeof(name), "%s, capacity %zu, batch %zu",
+			wakeup == Frames::Wakeup::None ? "poll" : "wait", capacity, batch);
+		benchmark::report(name, t, count);
+		benchmark::keep(sum);
+	}
+}
+
+int main()
+{
+	for (Frames::Wakeup wakeup : { Frames::Wakeup::None, Frames::Wakeup::Notify })
+	{
+		for (size_t capacity : { 64, 1024, 65536 })
+		{
+			run(capacity, 1, wakeup);
+			run(capacity, 64, wakeup);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Event costs as the callback count grows: add / add(first) / remove /
+// notify. add(first) is amortized O(1) (entries go in a reserve kept in front
+// of the array), so its time per operation should stay flat from 5k to 50k.
+//
+// event_benchmark, built with PICOEVENTS_BUILD_BENCHMARKS
+
+#include <vector>
+#include "picoevents.h"
+#include "benchmark.h"
+
+namespace
+{
+	void run(int count)
+	{
+		char name[64];
+		long total = 0;
+		std::vector<picoevents::SubscriptionID> ids(count);
+
+		picoevents::Event<int> event;
+		double t = benchmark::seconds([&] { for (auto& id : ids) id = event.add([&total](int i) { total += i; }); });
+		std::snprintf(name, sizeof(name), "add, %d callbacks", count);
+		benchmark::report(name, t, count);
+
+		t = benchmark::seconds([&] { for (int i = 0; i < 100; i++) event.notify(i); });
+		std::snprintf(name, sizeof(name), "notify, %d callbacks", count);
+		benchmark::report(name, t, 100.0 * count);
+
+		t = benchmark::seconds([&] { for (auto& id : ids) event.remove(id); });
+		std::snprintf(name, sizeof(name), "remove, %d callbacks", count);
+		benchmark::report(name, t, count);
+
+		picoevents::Event<int> front;
+		t = benchmark::seconds([&] { for (auto& id : ids) id = front.add([&total](int i) { total += i; }, true); });
+		std::snprintf(name, sizeof(name), "add(first), %d callbacks", count);
+		benchmark::report(name, t, count);
+
+		t = benchmark::seconds([&] { for (int i = 0; i < 100; i++) front.notify(i); });
+		std::snprintf(name, sizeof(name), "notify after add(first), %d callbacks", count);
+		benchmark::report(name, t, 100.0 * count);
+
+		// add(first) from a callback: deferred to the end of the dispatch
+		picoevents::Event<int> nested;
+		nested.add([&](int) { for (int i = 0; i < count; i++) nested.add([&total](int i) { total += i; }, true); });
+		t = benchmark::seconds([&] { nested.notify(0); });
+		std::snprintf(name, sizeof(name), "add(first) in notify, %d callbacks", count);
+		benchmark::report(name, t, count);
+
+		benchmark::keep(total);
+	}
+}
+
+int main()
+{
+	for (int count : { 500, 5000, 50000 })
+		run(count);
+	return 0;
+}
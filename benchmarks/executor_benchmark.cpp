@@ -0,0 +1,120 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Executor throughput and latency, for each idle mode:
+// - tasks per second posted from outside (through the injection queue) and
+//   from the workers (their own deques, then stolen)
+// - post to run latency percentiles, tasks posted one at a time from outside
+//
+// executor_benchmark [workers], built with PICOEVENTS_BUILD_BENCHMARKS
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "picoevents_executor.h"
+#include "benchmark.h"
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	const char* idleName(picoevents::Executor::Idle idle)
+	{
+		switch (idle)
+		{
+		case picoevents::Executor::Idle::Spin: return "spin";
+		case picoevents::Executor::Idle::Yield: return "yield";
+		default: return "park";
+		}
+	}
+
+	void throughput(size_t workers, picoevents::Executor::Idle idle)
+	{
+		const size_t count = 1000000;
+		char name[64];
+		std::atomic<size_t> done { 0 };
+		double t = benchmark::seconds([&] {
+			picoevents::Executor executor(workers, idle);
+			for (size_t i = 0; i < count; i++) executor.post([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+		});
+		std::snprintf(name, sizeof(name), "%s, posted from outside", idleName(idle));
+		benchmark::report(name, t, count);
+
+		// 1000 tasks each posting 1000 from their worker
+		t = benchmark::seconds([&] {
+			picoevents::Executor executor(workers, idle);
+			for (size_t i = 0; i < count / 1000; i++)
+			{
+				executor.post([&executor, &done] {
+					for (size_t j = 0; j < 1000; j++) executor.post([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+				});
+			}
+		});
+		std::snprintf(name, sizeof(name), "%s, posted from the workers", idleName(idle));
+		benchmark::report(name, t, count);
+		benchmark::keep(done.load());
+	}
+
+	void latency(size_t workers, picoevents::Executor::Idle idle)
+	{
+		const size_t count = 20000;
+		std::vector<double> ns(count);
+		{
+			picoevents::Executor executor(workers, idle);
+			for (size_t i = 0; i < count; i++)
+			{
+				std::atomic<bool> ran { false };
+				Clock::time_point posted = Clock::now();
+				executor.post([&ns, &ran, i, posted] {
+					ns[i] = std::chrono::duration<double, std::nano>(Clock::now() - posted).count();
+					ran.store(true, std::memory_order_release);
+				});
+				while (!ran.load(std::memory_order_acquire)) std::this_thread::yield();
+			}
+		}
+		std::sort(ns.begin(), ns.end());
+		auto at = [&ns](double p) { return ns[std::min(ns.size() - 1, (size_t)(p * ns.size()))]; };
+		std::printf("%-40s p50 %8.0f ns  p90 %8.0f ns  p99 %8.0f ns  p99.9 %8.0f ns\n",
+			idleName(idle), at(0.5), at(0.9), at(0.99), at(0.999));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t workers = argc > 1 ? (size_t)std::atoi(argv[1]) : 0;
+	if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+	std::printf("%zu workers\n", workers);
+	const picoevents::Executor::Idle modes[] = { picoevents::Executor::Idle::Park, picoevents::Executor::Idle::Yield, picoevents::Executor::Idle::Spin };
+	for (auto idle : modes) throughput(workers, idle);
+	std::printf("post to run latency\n");
+	for (auto idle : modes) latency(workers, idle);
+	return 0;
+}
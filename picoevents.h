@@ -26,10 +26,42 @@
  */
 #pragma once
  
-#include <list>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <memory>
 #include <functional>
 #include <tuple>
 #include <utility>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(PICOEVENTS_REGISTRY)
+#include <map>
+#include <mutex>
+#endif
+#if defined(PICOEVENTS_PROFILING)
+#include <atomic>
+#endif
+#if defined(PICOEVENTS_STORM_DETECTION)
+#include <cstdio>
+#include <unordered_map>
+#endif
+#include <cassert>
+#if defined(PICOEVENTS_CHECK_INVARIANTS)
+#define PICOEVENTS_CHECK() assert(checkInvariants())
+#else
+#define PICOEVENTS_CHECK()
+#endif
+// the debugging tools need the names given with Event::setName()
+#if defined(PICOEVENTS_REGISTRY) || defined(PICOEVENTS_STORM_DETECTION) || defined(PICOEVENTS_PROFILING)
+#define PICOEVENTS_EVENT_NAMES
+#endif
+#if defined(PICOEVENTS_EVENT_NAMES)
+#include <string>
+#endif
 
 /*
  A simple mechanism to notify events between various UI elements
@@ -75,14 +107,1364 @@ a different one.
 
 */
 
-namespace picoevents
-{
-	class ScopedCallbackIDBase
+namespace picoevents
+{
+	class ScopedCallbackIDBase
+	{
+	public:
+		ScopedCallbackIDBase() = default;
+		virtual ~ScopedCallbackIDBase() {}
+	};
+
+
+	// identifies a callback added to an Event
+	// (a slot index plus a generation, so that using a removed id is harmless)
+	struct SubscriptionID
+	{
+		static constexpr uint32_t Invalid = ~uint32_t(0);
+		uint32_t slot = Invalid;
+		uint32_t generation = 0;
+
+		bool operator==(const SubscriptionID& other) const
+		{
+			return slot == other.slot && generation == other.generation;
+		}
+		bool operator!=(const SubscriptionID& other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	//
+	// Debugging "who is subscribed to what": when PICOEVENTS_REGISTRY is defined for the
+	// whole project, every Event registers itself in Registry::global(), remembers where
+	// each of its callbacks was added and counts its notifications.
+	// Registry::toDot() / toJson() then dump the events, their callbacks and the
+	// cascades (an event notified from a callback of another one).
+	// Without PICOEVENTS_REGISTRY none of this is compiled, and setName() does nothing
+	//
+#if defined(PICOEVENTS_REGISTRY)
+	// where a callback was added
+	struct SourceLocation
+	{
+		const char* file = "";
+		int line = 0;
+		static SourceLocation current(const char* file = __builtin_FILE(), int line = __builtin_LINE())
+		{
+			return SourceLocation { file, line };
+		}
+	};
+#define PICOEVENTS_LOCATION_PARAM , picoevents::SourceLocation location = picoevents::SourceLocation::current()
+#define PICOEVENTS_LOCATION_DECL , picoevents::SourceLocation location
+#define PICOEVENTS_LOCATION_ARG , location
+
+	namespace detail
+	{
+		class EventCore;
+	}
+
+	class Registry
+	{
+	public:
+		static Registry& global()
+		{
+			static Registry registry;
+			return registry;
+		}
+
+		// graphviz: one box per event, one ellipse per callback, dashed edges for cascades
+		std::string toDot() const;
+		// { "events": [...], "cascades": [...] }
+		std::string toJson() const;
+		// sets the notification and cascade counts back to 0
+		void resetCounts();
+
+		// called by the events
+		void add(const detail::EventCore* e);
+		void remove(const detail::EventCore* e);
+		void enter(const detail::EventCore* e);
+		void leave();
+
+	private:
+		mutable std::mutex _mutex;
+		std::vector<const detail::EventCore*> _events;	// in creation order
+		std::map<std::pair<const detail::EventCore*, const detail::EventCore*>, uint64_t> _cascades;
+	};
+#else
+#define PICOEVENTS_LOCATION_PARAM
+#define PICOEVENTS_LOCATION_DECL
+#define PICOEVENTS_LOCATION_ARG
+#endif
+
+	//
+	// Finding notification storms: when PICOEVENTS_STORM_DETECTION is defined for the whole
+	// project, each thread follows the cascade started by a notify() (the notifications
+	// made from its callbacks, and so on) and reports it once if it goes over one of the limits:
+	// more than maxNotifications notifications, the same event notified more than
+	// maxRepeats times, or more than maxDepth nested notifications.
+	// The report holds the chain of events (root first) that led to the storm,
+	// by default it is printed on stderr
+	//
+#if defined(PICOEVENTS_STORM_DETECTION)
+	namespace detail
+	{
+		class EventCore;
+	}
+
+	class StormDetector
+	{
+	public:
+		struct Report
+		{
+			std::string reason;
+			size_t notifications;				// in the cascade so far
+			size_t depth;
+			std::vector<std::string> chain;		// names of the events being notified, root first
+		};
+		using Handler = std::function<void(const Report&)>;
+
+		// not thread-safe, meant to be called at startup
+		static void setLimits(size_t maxNotifications, size_t maxRepeats, size_t maxDepth)
+		{
+			settings().maxNotifications = maxNotifications;
+			settings().maxRepeats = maxRepeats;
+			settings().maxDepth = maxDepth;
+		}
+		static void setHandler(Handler h)
+		{
+			settings().handler = std::move(h);
+		}
+
+		// called by the events
+		static void enter(const detail::EventCore* e);
+		static void leave();
+
+	private:
+		struct Settings
+		{
+			size_t maxNotifications = 1000;
+			size_t maxRepeats = 100;
+			size_t maxDepth = 32;
+			Handler handler;
+		};
+		struct Count
+		{
+			size_t cascade = 0;
+			size_t notifications = 0;
+		};
+		struct Cascade
+		{
+			std::vector<const detail::EventCore*> stack;
+			// kept from one cascade to the next (the counts of older ones are stale),
+			// so that notifying an event already seen doesn't allocate
+			std::unordered_map<const detail::EventCore*, Count> counts;
+			size_t number = 0;
+			size_t notifications = 0;
+			bool reported = false;
+		};
+		static Settings& settings()
+		{
+			static Settings s;
+			return s;
+		}
+		static Cascade& cascade()
+		{
+			thread_local Cascade c;
+			return c;
+		}
+		static void report(const std::string& reason);
+	};
+#endif
+
+	//
+	// Sampling profilers: when PICOEVENTS_PROFILING is defined for the whole project and
+	// Profiling::setEnabled(true) was called, each thread publishes the callback it is
+	// calling. A SIGPROF handler (or any sampler interrupting the thread) reads
+	// Profiling::current() to attribute the sample to a subscription, rather than
+	// timing every callback.
+	// Reading it is async-signal-safe, as long as the thread notified something
+	// before (the thread_local is then allocated)
+	//
+#if defined(PICOEVENTS_PROFILING)
+	class Profiling
+	{
+	public:
+		struct Sample
+		{
+			const void* event;					// the EventCore
+			const char* name;					// given with Event::setName(), "" if none
+			SubscriptionID id;
+			const char* file;					// where the callback was added (PICOEVENTS_REGISTRY only)
+			int line;
+			const Sample* parent;				// the callback that notified this event, if any
+		};
+
+		static void setEnabled(bool b)
+		{
+			enabled().store(b, std::memory_order_relaxed);
+		}
+		static bool isEnabled()
+		{
+			return enabled().load(std::memory_order_relaxed);
+		}
+		// the callback being called by this thread, nullptr if none
+		static const Sample* current()
+		{
+			return slot();
+		}
+
+		// called by the events around each callback
+		static void enter(Sample& sample)
+		{
+			sample.parent = slot();
+			std::atomic_signal_fence(std::memory_order_release);
+			slot() = &sample;
+		}
+		static void leave(const Sample& sample)
+		{
+			slot() = sample.parent;
+			std::atomic_signal_fence(std::memory_order_release);
+		}
+
+	private:
+		static std::atomic<bool>& enabled()
+		{
+			static std::atomic<bool> b { false };
+			return b;
+		}
+		static const Sample*& slot()
+		{
+			thread_local const Sample* s = nullptr;
+			return s;
+		}
+	};
+#endif
+
+	namespace detail
+	{
+		inline unsigned countTrailingZeros(uint64_t x)
+		{
+#if defined(_MSC_VER)
+			unsigned long i;
+			_BitScanForward64(&i, x);
+			return (unsigned)i;
+#else
+			return (unsigned)__builtin_ctzll(x);
+#endif
+		}
+		inline unsigned highestBit(uint64_t x)
+		{
+#if defined(_MSC_VER)
+			unsigned long i;
+			_BitScanReverse64(&i, x);
+			return (unsigned)i;
+#else
+			return 63 - (unsigned)__builtin_clzll(x);
+#endif
+		}
+
+		// index of the first bit set in [from, end) or end if none
+		inline size_t nextBit(const std::vector<uint64_t>& bits, size_t from, size_t end)
+		{
+			if (from >= end) return end;
+			size_t w = from >> 6;
+			uint64_t word = bits[w] & (~uint64_t(0) << (from & 63));
+			size_t lastWord = (end - 1) >> 6;
+			for (;;)
+			{
+				if (word)
+				{
+					size_t i = (w << 6) + countTrailingZeros(word);
+					return i < end ? i : end;
+				}
+				if (++w > lastWord) return end;
+				word = bits[w];
+			}
+		}
+		inline void setBit(std::vector<uint64_t>& bits, size_t i, bool b)
+		{
+			if (b) bits[i >> 6] |= uint64_t(1) << (i & 63);
+			else bits[i >> 6] &= ~(uint64_t(1) << (i & 63));
+		}
+		inline bool getBit(const std::vector<uint64_t>& bits, size_t i)
+		{
+			return (bits[i >> 6] >> (i & 63)) & 1;
+		}
+
+
+		//
+		// the part of Event that doesn't depend on the callback signature:
+		// storage, ids, enabled / muted flags and reentrancy.
+		// It is shared by every Event<...>, which only adds a typed notify() loop and
+		// the boxing of the callbacks, so that each new signature costs very little code.
+		//
+		// A callback is stored as a context pointer and an invoke function pointer
+		// (cast back to void(*)(void*, T...) by Event<T...>), plus the Ops used to delete
+		// or copy the context.
+		// The entries are split in two parallel arrays: what notify() reads (Entry,
+		// 4 per cache line) and what only add / remove / copy and the debugging
+		// tools need (ColdEntry).
+		//
+		// The non trivial methods are defined below the class, see PICOEVENTS_SEPARATE_CORE
+		//
+		class EventCore;
+
+		// a SubscriptionGroup holds one per event it has ids of, in the list of the event,
+		// so that the event can tell the group it is destroyed (core becomes nullptr)
+		struct GroupLink
+		{
+			EventCore* core = nullptr;
+			GroupLink* prev = nullptr;
+			GroupLink* next = nullptr;
+		};
+
+		class EventCore
+		{
+		public:
+			using Invoke = void (*)();
+			struct Ops
+			{
+				void (*destroy)(void* context);
+				void* (*clone)(const void* context);
+			};
+			struct Entry
+			{
+				void* context;
+				Invoke invoke;
+			};
+			struct ColdEntry
+			{
+				const Ops* ops;
+#if defined(PICOEVENTS_REGISTRY)
+				SourceLocation location;
+#endif
+			};
+
+			EventCore()
+			{
+#if defined(PICOEVENTS_REGISTRY)
+				Registry::global().add(this);
+#endif
+			}
+			EventCore(const EventCore& other);
+			EventCore& operator=(const EventCore& other);
+			// leaves other without callbacks
+			EventCore(EventCore&& other) noexcept;
+			EventCore& operator=(EventCore&& other) noexcept;
+			~EventCore();
+
+			void setEnabled(bool b)
+			{
+				_enabled = b;
+			}
+			bool isEnabled() const
+			{
+				return _enabled;
+			}
+
+			SubscriptionID add(void* context, Invoke invoke, const Ops* ops, bool first PICOEVENTS_LOCATION_DECL);
+			void remove(SubscriptionID& id);
+			// a callback that is only an object and a function, not deleted nor copied.
+			// They are indexed so that they can be removed by value
+			SubscriptionID addDelegate(void* object, Invoke invoke, bool first PICOEVENTS_LOCATION_DECL);
+			// removes one of the callbacks added with addDelegate(object, invoke), false if none
+			bool removeDelegate(void* object, Invoke invoke);
+			// replaces the callback of id, keeping its place
+			bool replace(SubscriptionID id, void* context, Invoke invoke, const Ops* ops);
+			// moves the callback of id to another event (of the same signature), without
+			// copying nor deleting it. Returns its id in to, id becomes invalid
+			SubscriptionID moveTo(SubscriptionID& id, EventCore& to, bool first);
+
+			// the groups holding ids of this event. They stay with this object:
+			// neither copied nor moved
+			void link(GroupLink* l)
+			{
+				l->core = this;
+				l->prev = nullptr;
+				l->next = _groups;
+				if (_groups) _groups->prev = l;
+				_groups = l;
+			}
+			void unlink(GroupLink* l)
+			{
+				if (l->prev) l->prev->next = l->next;
+				else _groups = l->next;
+				if (l->next) l->next->prev = l->prev;
+				l->core = nullptr;
+			}
+
+			bool isValid(SubscriptionID id) const
+			{
+				return id.slot < _slots.size()
+					&& _slots[id.slot].generation == id.generation
+					&& _slots[id.slot].position != SubscriptionID::Invalid;
+			}
+			// nullptr if id is not valid
+			const Entry* find(SubscriptionID id) const
+			{
+				return isValid(id) ? &_entries[_slots[id.slot].position] : nullptr;
+			}
+			// number of callbacks (muted ones included)
+			size_t size() const
+			{
+				return _entries.size() - _dead - _front;
+			}
+
+			void setMuted(SubscriptionID id, bool muted);
+			bool isMuted(SubscriptionID id) const
+			{
+				return isValid(id) && _slots[id.slot].muted;
+			}
+
+			// true when the ids, positions, active bits and counters agree.
+			// Meant for tests and fuzzing, with PICOEVENTS_CHECK_INVARIANTS defined
+			// it is asserted after each modification
+			bool checkInvariants() const;
+
+#if defined(PICOEVENTS_EVENT_NAMES)
+			void setName(const char* name)
+			{
+				_name = name;
+			}
+			const char* getName() const
+			{
+				return _name.c_str();
+			}
+#endif
+
+			//
+			// calls f(entry) for each callback that is neither removed nor muted,
+			// in notification order. The _active bits are read again after each call,
+			// so a callback can remove or mute any other one.
+			// Callbacks added or unmuted while notifying are not called by this notification,
+			// the unmuted ones not by the nested notifications either
+			//
+			template<typename F>
+			void dispatch(F&& f) const
+			{
+				dispatch<false>(f);
+			}
+			// same, calling f(entry, last), last is true for the last callback to be called
+			// (unless it is removed or muted meanwhile), which can be given moved arguments
+			template<typename F>
+			void dispatchLast(F&& f) const
+			{
+				dispatch<true>(f);
+			}
+
+		private:
+			struct Slot
+			{
+				uint32_t position = SubscriptionID::Invalid;
+				uint32_t generation = 0;
+				bool muted = false;
+			};
+
+			// notifications can be nested, the removed callbacks are deleted
+			// when the outermost one is over
+			struct DispatchScope
+			{
+				const EventCore& _core;
+				DispatchScope(const EventCore& core) : _core(core)
+				{
+					_core._depth++;
+#if defined(PICOEVENTS_REGISTRY)
+					_core._notifyCount++;
+					Registry::global().enter(&_core);
+#endif
+#if defined(PICOEVENTS_STORM_DETECTION)
+					StormDetector::enter(&_core);
+#endif
+				}
+				~DispatchScope()
+				{
+#if defined(PICOEVENTS_STORM_DETECTION)
+					StormDetector::leave();
+#endif
+#if defined(PICOEVENTS_REGISTRY)
+					Registry::global().leave();
+#endif
+					if (--_core._depth == 0 && (_core._pendingDelete || !_core._pendingFront.empty() || !_core._pendingUnmute.empty())) _core.endDispatch();
+				}
+			};
+			void endDispatch() const;
+
+#if defined(PICOEVENTS_PROFILING)
+			Profiling::Sample profilingSample(size_t i) const
+			{
+				uint32_t slot = _slotOf[i];
+				Profiling::Sample sample { this, _name.c_str(), SubscriptionID { slot, _slots[slot].generation }, "", 0, nullptr };
+#if defined(PICOEVENTS_REGISTRY)
+				sample.file = _cold[i].location.file;
+				sample.line = _cold[i].location.line;
+#endif
+				return sample;
+			}
+#endif
+
+			template<bool Last, typename F>
+			void dispatch(F& f) const
+			{
+				DispatchScope scope(*this);
+				size_t end = _entries.size();
+				size_t words = (end + 63) >> 6;
+				size_t last = SIZE_MAX;
+				if (Last)
+				{
+					for (size_t w = words; w-- > 0;)
+					{
+						uint64_t bits = _active[w];
+						if (w == words - 1 && (end & 63)) bits &= ~(~uint64_t(0) << (end & 63));
+						if (bits)
+						{
+							last = (w << 6) + highestBit(bits);
+							break;
+						}
+					}
+				}
+#if defined(PICOEVENTS_PROFILING)
+				bool profiling = Profiling::isEnabled();
+#endif
+				// the unused front has no active bit
+				for (size_t w = _front >> 6; w < words; w++)
+				{
+					uint64_t bits = _active[w];
+					if (w == words - 1 && (end & 63)) bits &= ~(~uint64_t(0) << (end & 63));
+					while (bits)
+					{
+						size_t i = (w << 6) + countTrailingZeros(bits);
+						bits &= bits - 1;
+#if defined(PICOEVENTS_PROFILING)
+						if (profiling)
+						{
+							Profiling::Sample sample = profilingSample(i);
+							Profiling::enter(sample);
+							if constexpr (Last) f(_entries[i], i == last);
+							else f(_entries[i]);
+							Profiling::leave(sample);
+						}
+						else
+#endif
+						if constexpr (Last) f(_entries[i], i == last);
+						else f(_entries[i]);
+						// skip what the callback removed or muted
+						bits &= _active[w];
+					}
+				}
+			}
+
+			static void release(Entry& e, const Ops* ops)
+			{
+				if (e.context && ops) ops->destroy(e.context);
+				e.context = nullptr;
+			}
+			// the entries added with addDelegate() have no Ops
+			bool isDelegate(size_t i) const
+			{
+				return _entries[i].context && !_cold[i].ops;
+			}
+			void unindexDelegate(const Entry& e, uint32_t slot);
+			void clear();
+			// a free position in front of the others, see _front
+			size_t takeFront() const;
+			// moves the callback of slot in front of the others
+			void moveToFront(uint32_t slot) const;
+			// drops the removed callbacks
+			void compact() const;
+
+			// mutable as a notification drops the callbacks removed while it was running
+			mutable std::vector<Entry> _entries;		// in notification order
+			mutable std::vector<ColdEntry> _cold;		// same order, not read by dispatch()
+			mutable std::vector<uint32_t> _slotOf;		// slot of each entry
+			mutable std::vector<uint64_t> _active;		// bit set: to be called
+			mutable std::vector<Slot> _slots;			// position of each id
+			std::vector<uint32_t> _freeSlots;
+			mutable size_t _dead = 0;
+			// the first _front entries are unused (like removed ones, but not counted in _dead):
+			// adding first takes the last of them, so that it doesn't move the others
+			mutable size_t _front = 0;
+			mutable bool _pendingDelete = false;
+			GroupLink* _groups = nullptr;
+			mutable std::vector<SubscriptionID> _pendingFront;	// added first while notifying
+			mutable std::vector<SubscriptionID> _pendingUnmute;	// unmuted while notifying
+			// the delegates index: an open addressing table of slots, hashed on the object
+			// and function of their entry, so that adding one only allocates when it grows
+			static constexpr uint32_t NoDelegate = SubscriptionID::Invalid;
+			static constexpr uint32_t RemovedDelegate = SubscriptionID::Invalid - 1;
+			static size_t delegateHash(const void* object, Invoke invoke)
+			{
+				uint64_t h = uint64_t(reinterpret_cast<uintptr_t>(object)) * 0x9e3779b97f4a7c15ull ^ uint64_t(reinterpret_cast<uintptr_t>(invoke));
+				h ^= h >> 29;
+				h *= 0xbf58476d1ce4e5b9ull;
+				return size_t(h ^ (h >> 32));
+			}
+			void indexDelegate(const Entry& e, uint32_t slot);
+			void rehashDelegates(size_t capacity);
+			std::vector<uint32_t> _delegates;			// power of 2 size, empty until the first delegate
+			size_t _delegatesUsed = 0;					// slots and RemovedDelegate markers
+			size_t _delegatesLive = 0;
+			bool _enabled = true;
+			mutable int _depth = 0;						// notifications in progress
+#if defined(PICOEVENTS_EVENT_NAMES)
+			std::string _name;
+#endif
+#if defined(PICOEVENTS_REGISTRY)
+			mutable uint64_t _notifyCount = 0;
+			friend class picoevents::Registry;
+#endif
+		};
+
+
+		//
+		// By default the header is self contained and these are inline.
+		// Defining PICOEVENTS_SEPARATE_CORE for the whole project (and adding picoevents.cpp
+		// to it) compiles them only once, in picoevents.cpp
+		//
+#if !defined(PICOEVENTS_SEPARATE_CORE) || defined(PICOEVENTS_CORE_IMPLEMENTATION)
+#if defined(PICOEVENTS_SEPARATE_CORE)
+#define PICOEVENTS_CORE_INLINE
+#else
+#define PICOEVENTS_CORE_INLINE inline
+#endif
+
+		PICOEVENTS_CORE_INLINE EventCore::EventCore(const EventCore& other)
+		{
+#if defined(PICOEVENTS_REGISTRY)
+			Registry::global().add(this);
+#endif
+			*this = other;
+		}
+
+		PICOEVENTS_CORE_INLINE EventCore& EventCore::operator=(const EventCore& other)
+		{
+			if (this == &other) return *this;
+			clear();
+			_entries = other._entries;
+			_cold = other._cold;
+			for (size_t i = 0; i < _entries.size(); i++)
+			{
+				if (_entries[i].context && _cold[i].ops) _entries[i].context = _cold[i].ops->clone(_entries[i].context);
+			}
+			_slotOf = other._slotOf;
+			_active = other._active;
+			_slots = other._slots;
+			_freeSlots = other._freeSlots;
+			_dead = other._dead;
+			_front = other._front;
+			_enabled = other._enabled;
+			_delegates = other._delegates;
+			_delegatesUsed = other._delegatesUsed;
+			_delegatesLive = other._delegatesLive;
+#if defined(PICOEVENTS_EVENT_NAMES)
+			_name = other._name;
+#endif
+			return *this;
+		}
+
+		PICOEVENTS_CORE_INLINE EventCore::EventCore(EventCore&& other) noexcept
+		{
+#if defined(PICOEVENTS_REGISTRY)
+			Registry::global().add(this);
+#endif
+			*this = std::move(other);
+		}
+
+		PICOEVENTS_CORE_INLINE EventCore& EventCore::operator=(EventCore&& other) noexcept
+		{
+			if (this == &other) return *this;
+			// a notification of other would go on with the emptied arrays
+			assert(other._depth == 0);
+			clear();
+			// other gets the arrays just cleared, so that it stays usable
+			_entries.swap(other._entries);
+			_cold.swap(other._cold);
+			_slotOf.swap(other._slotOf);
+			_active.swap(other._active);
+			_slots.swap(other._slots);
+			_freeSlots.swap(other._freeSlots);
+			_delegates.swap(other._delegates);
+			_dead = other._dead;
+			_front = other._front;
+			_delegatesUsed = other._delegatesUsed;
+			_delegatesLive = other._delegatesLive;
+			_enabled = other._enabled;
+			other._dead = 0;
+			other._front = 0;
+			other._delegatesUsed = 0;
+			other._delegatesLive = 0;
+#if defined(PICOEVENTS_EVENT_NAMES)
+			_name = std::move(other._name);
+			other._name.clear();
+#endif
+			return *this;
+		}
+
+		PICOEVENTS_CORE_INLINE EventCore::~EventCore()
+		{
+#if defined(PICOEVENTS_REGISTRY)
+			Registry::global().remove(this);
+#endif
+			for (GroupLink* l = _groups; l; l = l->next) l->core = nullptr;
+			clear();
+		}
+
+		PICOEVENTS_CORE_INLINE SubscriptionID EventCore::add(void* context, Invoke invoke, const Ops* ops, bool first PICOEVENTS_LOCATION_DECL)
+		{
+			uint32_t slot;
+			if (_freeSlots.empty())
+			{
+				slot = (uint32_t)_slots.size();
+				_slots.push_back(Slot());
+			}
+			else
+			{
+				slot = _freeSlots.back();
+				_freeSlots.pop_back();
+			}
+			ColdEntry cold;
+			cold.ops = ops;
+#if defined(PICOEVENTS_REGISTRY)
+			cold.location = location;
+#endif
+			bool front = first && size() > 0;
+			size_t pos;
+			if (front && _depth == 0)
+			{
+				pos = takeFront();
+				_entries[pos] = Entry { context, invoke };
+				_cold[pos] = cold;
+				_slotOf[pos] = slot;
+			}
+			else
+			{
+				pos = _entries.size();
+				_entries.push_back(Entry { context, invoke });
+				_cold.push_back(cold);
+				_slotOf.push_back(slot);
+				if ((pos & 63) == 0) _active.push_back(0);
+				// positions can't change while notifying, it is moved
+				// to the front once the notification is over
+				if (front) _pendingFront.push_back(SubscriptionID { slot, _slots[slot].generation });
+			}
+			_slots[slot].position = (uint32_t)pos;
+			_slots[slot].muted = false;
+			setBit(_active, pos, true);
+			PICOEVENTS_CHECK();
+			return SubscriptionID { slot, _slots[slot].generation };
+		}
+
+		PICOEVENTS_CORE_INLINE void EventCore::remove(SubscriptionID& id)
+		{
+			if (isValid(id))
+			{
+				Slot& s = _slots[id.slot];
+				size_t pos = s.position;
+				if (isDelegate(pos)) unindexDelegate(_entries[pos], id.slot);
+				setBit(_active, pos, false);
+				_slotOf[pos] = SubscriptionID::Invalid;
+				s.position = SubscriptionID::Invalid;
+				s.generation++;
+				_freeSlots.push_back(id.slot);
+				_dead++;
+				if (_depth > 0)
+				{
+					// the callback may be the one being called,
+					// it is deleted once the notification is over
+					_pendingDelete = true;
+				}
+				else
+				{
+					release(_entries[pos], _cold[pos].ops);
+					if (_dead > (_entries.size() - _front) / 2) compact();
+				}
+				PICOEVENTS_CHECK();
+			}
+			id = SubscriptionID();
+		}
+
+		PICOEVENTS_CORE_INLINE bool EventCore::replace(SubscriptionID id, void* context, Invoke invoke, const Ops* ops)
+		{
+			if (!isValid(id))
+			{
+				if (ops) ops->destroy(context);
+				return false;
+			}
+			size_t pos = _slots[id.slot].position;
+			Entry prev = _entries[pos];
+			const Ops* prevOps = _cold[pos].ops;
+			if (isDelegate(pos)) unindexDelegate(prev, id.slot);
+			ColdEntry cold = _cold[pos];
+			_entries[pos] = Entry { context, invoke };
+			_cold[pos].ops = ops;
+			if (_depth > 0 && prev.context && prevOps)
+			{
+				// the previous callback may be the one being called, it is kept
+				// as a removed entry and deleted once the notification is over
+				size_t dead = _entries.size();
+				_entries.push_back(prev);
+				_cold.push_back(cold);
+				_slotOf.push_back(SubscriptionID::Invalid);
+				if ((dead & 63) == 0) _active.push_back(0);
+				_dead++;
+				_pendingDelete = true;
+			}
+			else release(prev, prevOps);
+			PICOEVENTS_CHECK();
+			return true;
+		}
+
+		PICOEVENTS_CORE_INLINE SubscriptionID EventCore::moveTo(SubscriptionID& id, EventCore& to, bool first)
+		{
+			if (!isValid(id)) return SubscriptionID();
+			if (&to == this) return id;
+			size_t pos = _slots[id.slot].position;
+			Entry e = _entries[pos];
+			ColdEntry cold = _cold[pos];
+			bool muted = _slots[id.slot].muted;
+			bool delegate = isDelegate(pos);
+			if (delegate) unindexDelegate(e, id.slot);
+			// the callable now belongs to to, remove() must not delete it
+			// (even later, if this is notifying)
+			_entries[pos].context = nullptr;
+			remove(id);
+#if defined(PICOEVENTS_REGISTRY)
+			SubscriptionID res = delegate ? to.addDelegate(e.context, e.invoke, first, cold.location) : to.add(e.context, e.invoke, cold.ops, first, cold.location);
+#else
+			SubscriptionID res = delegate ? to.addDelegate(e.context, e.invoke, first) : to.add(e.context, e.invoke, cold.ops, first);
+#endif
+			if (muted) to.setMuted(res, true);
+			return res;
+		}
+
+		PICOEVENTS_CORE_INLINE SubscriptionID EventCore::addDelegate(void* object, Invoke invoke, bool first PICOEVENTS_LOCATION_DECL)
+		{
+			SubscriptionID id = add(object, invoke, nullptr, first PICOEVENTS_LOCATION_ARG);
+			indexDelegate(Entry { object, invoke }, id.slot);
+			return id;
+		}
+
+		PICOEVENTS_CORE_INLINE bool EventCore::removeDelegate(void* object, Invoke invoke)
+		{
+			if (_delegatesLive == 0) return false;
+			size_t mask = _delegates.size() - 1;
+			for (size_t i = delegateHash(object, invoke) & mask; _delegates[i] != NoDelegate; i = (i + 1) & mask)
+			{
+				uint32_t slot = _delegates[i];
+				if (slot == RemovedDelegate) continue;
+				const Entry& e = _entries[_slots[slot].position];
+				if (e.context == object && e.invoke == invoke)
+				{
+					SubscriptionID id { slot, _slots[slot].generation };
+					remove(id);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		PICOEVENTS_CORE_INLINE void EventCore::indexDelegate(const Entry& e, uint32_t slot)
+		{
+			// at most 3/4 full, markers included
+			if ((_delegatesUsed + 1) * 4 > _delegates.size() * 3)
+			{
+				size_t capacity = 16;
+				while (capacity * 3 < (_delegatesLive + 1) * 8) capacity *= 2;
+				rehashDelegates(capacity);
+			}
+			size_t mask = _delegates.size() - 1;
+			size_t i = delegateHash(e.context, e.invoke) & mask;
+			while (_delegates[i] != NoDelegate && _delegates[i] != RemovedDelegate) i = (i + 1) & mask;
+			if (_delegates[i] == NoDelegate) _delegatesUsed++;
+			_delegates[i] = slot;
+			_delegatesLive++;
+		}
+
+		PICOEVENTS_CORE_INLINE void EventCore::unindexDelegate(const Entry& e, uint32_t slot)
+		{
+			size_t mask = _delegates.size() - 1;
+			for (size_t i = delegateHash(e.context, e.invoke) & mask; _delegates[i] != NoDelegate; i = (i + 1) & mask)
+			{
+				if (_delegates[i] == slot)
+				{
+					_delegates[i] = RemovedDelegate;
+					_delegatesLive--;
+					return;
+				}
+			}
+		}
+
+		PICOEVENTS_CORE_INLINE void EventCore::rehashDelegates(size_t capacity)
+		{
+			std::vector<uint32_t> old(capacity, NoDelegate);
+			old.swap(_delegates);
+			_delegatesUsed = 0;
+			_delegatesLive = 0;
+			for (uint32_t slot : old)
+			{
+				if (slot < RemovedDelegate) indexDelegate(_entries[_slots[slot].position], slot);
+			}
+		}
+
+		PICOEVENTS_CORE_INLINE void EventCore::setMuted(SubscriptionID id, bool muted)
+		{
+			if (isValid(id))
+			{
+				Slot& s = _slots[id.slot];
+				s.muted = muted;
+				// an unmuted callback is only called by the next notifications, whatever
+				// its position compared to the callbacks being called
+				if (muted || _depth == 0) setBit(_active, s.position, !muted);
+				else _pendingUnmute.push_back(id);
+				PICOEVENTS_CHECK();
+			}
+		}
+
+		PICOEVENTS_CORE_INLINE void EventCore::endDispatch() const
+		{
+			if (_pendingDelete) compact();
+			for (SubscriptionID id : _pendingFront)
+			{
+				// it may have been removed meanwhile, and its slot reused
+				if (isValid(id)) moveToFront(id.slot);
+			}
+			_pendingFront.clear();
+			// the places they left
+			if (_dead > (_entries.size() - _front) / 2) compact();
+			for (SubscriptionID id : _pendingUnmute)
+			{
+				if (isValid(id) && !_slots[id.slot].muted) setBit(_active, _slots[id.slot].position, true);
+			}
+			_pendingUnmute.clear();
+			PICOEVENTS_CHECK();
+		}
+
+		PICOEVENTS_CORE_INLINE void EventCore::clear()
+		{
+			for (size_t i = 0; i < _entries.size(); i++) release(_entries[i], _cold[i].ops);
+			_entries.clear();
+			_cold.clear();
+			_slotOf.clear();
+			_active.clear();
+			_slots.clear();
+			_freeSlots.clear();
+			_front = 0;
+			_pendingFront.clear();
+			_pendingUnmute.clear();
+			_delegates.clear();
+			_delegatesUsed = 0;
+			_delegatesLive = 0;
+			_dead = 0;
+		}
+
+		PICOEVENTS_CORE_INLINE size_t EventCore::takeFront() const
+		{
+			if (_front == 0)
+			{
+				// grows the unused front by at least the number of entries, so that
+				// adding first is amortized O(1), and by whole words of active bits
+				// so that the others only move by words
+				size_t grow = (std::max<size_t>(_entries.size(), 1) + 63) & ~size_t(63);
+				_entries.insert(_entries.begin(), grow, Entry { nullptr, nullptr });
+				_cold.insert(_cold.begin(), grow, ColdEntry());
+				_slotOf.insert(_slotOf.begin(), grow, SubscriptionID::Invalid);
+				_active.insert(_active.begin(), grow >> 6, 0);
+				for (size_t i = grow; i < _entries.size(); i++)
+				{
+					if (_slotOf[i] != SubscriptionID::Invalid) _slots[_slotOf[i]].position += (uint32_t)grow;
+				}
+				_front = grow;
+			}
+			return --_front;
+		}
+
+		PICOEVENTS_CORE_INLINE void EventCore::moveToFront(uint32_t slot) const
+		{
+			size_t to = takeFront();
+			size_t pos = _slots[slot].position;
+			_entries[to] = _entries[pos];
+			_cold[to] = _cold[pos];
+			_slotOf[to] = slot;
+			setBit(_active, to, getBit(_active, pos));
+			_slots[slot].position = (uint32_t)to;
+			// the callable moved, the place it leaves is a removed entry
+			_entries[pos].context = nullptr;
+			_slotOf[pos] = SubscriptionID::Invalid;
+			setBit(_active, pos, false);
+			_dead++;
+		}
+
+		PICOEVENTS_CORE_INLINE void EventCore::compact() const
+		{
+			// the unused front is kept, unless it is much bigger than what remains
+			size_t live = _entries.size() - _front - _dead;
+			size_t front = _front <= 2 * live + 64 ? _front : 0;
+			size_t n = front;
+			for (size_t i = _front; i < _entries.size(); i++)
+			{
+				if (_slotOf[i] == SubscriptionID::Invalid)
+				{
+					release(_entries[i], _cold[i].ops);
+					continue;
+				}
+				bool active = getBit(_active, i);
+				_entries[n] = _entries[i];
+				_cold[n] = _cold[i];
+				_slotOf[n] = _slotOf[i];
+				_slots[_slotOf[n]].position = (uint32_t)n;
+				setBit(_active, n, active);
+				n++;
+			}
+			_entries.resize(n);
+			_cold.resize(n);
+			_slotOf.resize(n);
+			_active.resize((n + 63) >> 6);
+			if (n & 63) _active.back() &= ~(~uint64_t(0) << (n & 63));
+			_front = front;
+			_dead = 0;
+			_pendingDelete = false;
+		}
+
+		PICOEVENTS_CORE_INLINE bool EventCore::checkInvariants() const
+		{
+			size_t n = _entries.size();
+			if (_cold.size() != n || _slotOf.size() != n || _active.size() != (n + 63) >> 6) return false;
+			// nothing active past the end
+			if ((n & 63) && (_active.back() >> (n & 63))) return false;
+			if (_front > n) return false;
+			size_t dead = 0;
+			for (size_t i = 0; i < n; i++)
+			{
+				uint32_t slot = _slotOf[i];
+				if (i < _front && (slot != SubscriptionID::Invalid || _entries[i].context)) return false;
+				if (slot == SubscriptionID::Invalid)
+				{
+					dead++;
+					if (getBit(_active, i)) return false;
+					continue;
+				}
+				if (slot >= _slots.size() || _slots[slot].position != i) return false;
+				// inactive and not muted: unmuted while notifying
+				if (getBit(_active, i) && _slots[slot].muted) return false;
+				if (!getBit(_active, i) && !_slots[slot].muted && _depth == 0) return false;
+			}
+			if (dead != _dead + _front) return false;
+			// every slot is either used by an entry or free
+			size_t used = 0;
+			for (const Slot& slot : _slots)
+			{
+				if (slot.position != SubscriptionID::Invalid) used++;
+			}
+			if (used != n - dead || used + _freeSlots.size() != _slots.size()) return false;
+			for (uint32_t slot : _freeSlots)
+			{
+				if (slot >= _slots.size() || _slots[slot].position != SubscriptionID::Invalid) return false;
+			}
+			// the delegates index points to live delegates, each reachable from its hash
+			size_t live = 0, markers = 0;
+			for (size_t i = 0; i < _delegates.size(); i++)
+			{
+				uint32_t slot = _delegates[i];
+				if (slot == NoDelegate) continue;
+				markers++;
+				if (slot == RemovedDelegate) continue;
+				live++;
+				if (slot >= _slots.size() || _slots[slot].position == SubscriptionID::Invalid) return false;
+				size_t pos = _slots[slot].position;
+				if (!isDelegate(pos)) return false;
+				size_t mask = _delegates.size() - 1;
+				for (size_t j = delegateHash(_entries[pos].context, _entries[pos].invoke) & mask; j != i; j = (j + 1) & mask)
+				{
+					if (_delegates[j] == NoDelegate) return false;
+				}
+			}
+			if (live != _delegatesLive || markers != _delegatesUsed) return false;
+			return _depth > 0 || (_pendingFront.empty() && _pendingUnmute.empty());
+		}
+
+#undef PICOEVENTS_CORE_INLINE
+#endif
+	}
+
+
+#if defined(PICOEVENTS_STORM_DETECTION)
+	inline void StormDetector::enter(const detail::EventCore* e)
+	{
+		Cascade& c = cascade();
+		if (c.stack.empty())
+		{
+			// the destroyed events are only dropped from time to time
+			if (c.counts.size() > 4096) c.counts.clear();
+			c.number++;
+			c.notifications = 0;
+			c.reported = false;
+		}
+		c.stack.push_back(e);
+		c.notifications++;
+		Count& count = c.counts[e];
+		if (count.cascade != c.number) count = Count { c.number, 0 };
+		size_t repeats = ++count.notifications;
+		if (c.reported) return;
+		const Settings& s = settings();
+		if (c.notifications > s.maxNotifications)
+		{
+			report("more than " + std::to_string(s.maxNotifications) + " notifications");
+		}
+		else if (repeats > s.maxRepeats)
+		{
+			report("same event notified more than " + std::to_string(s.maxRepeats) + " times");
+		}
+		else if (c.stack.size() > s.maxDepth)
+		{
+			report("more than " + std::to_string(s.maxDepth) + " nested notifications");
+		}
+	}
+
+	inline void StormDetector::leave()
+	{
+		cascade().stack.pop_back();
+	}
+
+	inline void StormDetector::report(const std::string& reason)
+	{
+		Cascade& c = cascade();
+		c.reported = true;
+		Report r { reason, c.notifications, c.stack.size(), {} };
+		for (auto* e : c.stack)
+		{
+			std::string name = e->getName();
+			if (name.empty())
+			{
+				char buffer[32];
+				snprintf(buffer, sizeof(buffer), "%p", (const void*)e);
+				name = buffer;
+			}
+			r.chain.push_back(name);
+		}
+		if (settings().handler)
+		{
+			settings().handler(r);
+			return;
+		}
+		fprintf(stderr, "picoevents: notification storm, %s (%zu notifications, depth %zu)\n", reason.c_str(), r.notifications, r.depth);
+		for (size_t i = 0; i < r.chain.size(); i++)
+		{
+			fprintf(stderr, "  %*s%s\n", (int)(2 * i), "", r.chain[i].c_str());
+		}
+	}
+#endif
+
+
+#if defined(PICOEVENTS_REGISTRY)
+	namespace detail
+	{
+		// the events being notified by the current thread, innermost last
+		inline std::vector<const EventCore*>& dispatchStack()
+		{
+			thread_local std::vector<const EventCore*> stack;
+			return stack;
+		}
+		inline std::string escape(const char* s)
+		{
+			std::string res;
+			for (; *s; s++)
+			{
+				if (*s == '"' || *s == '\\') res += '\\';
+				res += *s;
+			}
+			return res;
+		}
+	}
+
+	inline void Registry::add(const detail::EventCore* e)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_events.push_back(e);
+	}
+
+	inline void Registry::remove(const detail::EventCore* e)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_events.erase(std::remove(_events.begin(), _events.end(), e), _events.end());
+		for (auto it = _cascades.begin(); it != _cascades.end();)
+		{
+			if (it->first.first == e || it->first.second == e) it = _cascades.erase(it);
+			else it++;
+		}
+	}
+
+	inline void Registry::enter(const detail::EventCore* e)
+	{
+		auto& stack = detail::dispatchStack();
+		if (!stack.empty())
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_cascades[{ stack.back(), e }]++;
+		}
+		stack.push_back(e);
+	}
+
+	inline void Registry::leave()
+	{
+		detail::dispatchStack().pop_back();
+	}
+
+	inline void Registry::resetCounts()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto* e : _events) e->_notifyCount = 0;
+		for (auto& c : _cascades) c.second = 0;
+	}
+
+	inline std::string Registry::toDot() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		std::map<const detail::EventCore*, size_t> ids;
+		std::string res = "digraph picoevents\n{\n";
+		for (auto* e : _events)
+		{
+			size_t id = ids.size();
+			ids[e] = id;
+			std::string node = "e" + std::to_string(id);
+			res += "\t" + node + " [shape=box, label=\"" + detail::escape(e->getName())
+				+ "\\n" + std::to_string(e->size()) + " callbacks\\n"
+				+ std::to_string(e->_notifyCount) + " notifications\"];\n";
+			size_t n = 0;
+			for (size_t i = 0; i < e->_entries.size(); i++)
+			{
+				if (e->_slotOf[i] == SubscriptionID::Invalid) continue;
+				const detail::EventCore::ColdEntry& entry = e->_cold[i];
+				std::string cb = node + "_" + std::to_string(n++);
+				res += "\t" + cb + " [label=\"" + detail::escape(entry.location.file) + ":" + std::to_string(entry.location.line)
+					+ (e->_slots[e->_slotOf[i]].muted ? " (muted)" : "") + "\"];\n";
+				res += "\t" + node + " -> " + cb + ";\n";
+			}
+		}
+		for (auto& c : _cascades)
+		{
+			res += "\te" + std::to_string(ids[c.first.first]) + " -> e" + std::to_string(ids[c.first.second])
+				+ " [style=dashed, label=\"" + std::to_string(c.second) + "\"];\n";
+		}
+		res += "}\n";
+		return res;
+	}
+
+	inline std::string Registry::toJson() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		std::map<const detail::EventCore*, size_t> ids;
+		std::string res = "{ \"events\": [";
+		for (auto* e : _events)
+		{
+			size_t id = ids.size();
+			ids[e] = id;
+			res += std::string(id ? ", " : "") + "{ \"id\": " + std::to_string(id)
+				+ ", \"name\": \"" + detail::escape(e->getName())
+				+ "\", \"notifications\": " + std::to_string(e->_notifyCount) + ", \"callbacks\": [";
+			bool firstCallback = true;
+			for (size_t i = 0; i < e->_entries.size(); i++)
+			{
+				if (e->_slotOf[i] == SubscriptionID::Invalid) continue;
+				const detail::EventCore::ColdEntry& entry = e->_cold[i];
+				res += std::string(firstCallback ? "" : ", ") + "{ \"file\": \"" + detail::escape(entry.location.file)
+					+ "\", \"line\": " + std::to_string(entry.location.line)
+					+ ", \"muted\": " + (e->_slots[e->_slotOf[i]].muted ? "true" : "false") + " }";
+				firstCallback = false;
+			}
+			res += "] }";
+		}
+		res += "], \"cascades\": [";
+		bool firstCascade = true;
+		for (auto& c : _cascades)
+		{
+			res += std::string(firstCascade ? "" : ", ") + "{ \"from\": " + std::to_string(ids[c.first.first])
+				+ ", \"to\": " + std::to_string(ids[c.first.second]) + ", \"count\": " + std::to_string(c.second) + " }";
+			firstCascade = false;
+		}
+		res += "] }\n";
+		return res;
+	}
+#endif
+
+
+	namespace detail
+	{
+		// a callable stored on the heap, called through invoke
+		template<typename F, typename ...T>
+		struct Boxed
+		{
+			static void invoke(void* context, T... t)
+			{
+				(*static_cast<F*>(context))(std::forward<T>(t)...);
+			}
+			static EventCore::Invoke invoker()
+			{
+				return reinterpret_cast<EventCore::Invoke>(&invoke);
+			}
+			static void destroy(void* context)
+			{
+				delete static_cast<F*>(context);
+			}
+			static void* clone(const void* context)
+			{
+				return new F(*static_cast<const F*>(context));
+			}
+			static constexpr EventCore::Ops ops { &destroy, &clone };
+		};
+
+		// true for the callables (other than Callback itself) that Event::add() can store
+		template<typename F, typename Callback, typename ...T>
+		struct IsCallable : std::integral_constant<bool,
+			!std::is_same<typename std::decay<F>::type, Callback>::value
+			&& std::is_copy_constructible<typename std::decay<F>::type>::value
+			&& std::is_invocable<typename std::decay<F>::type&, T...>::value> {};
+	}
+
+
+	namespace detail
+	{
+		template<typename M>
+		struct MemberTraits;
+		template<typename C, typename R, typename ...A>
+		struct MemberTraits<R (C::*)(A...)>
+		{
+			using Class = C;
+		};
+		template<typename C, typename R, typename ...A>
+		struct MemberTraits<R (C::*)(A...) const>
+		{
+			using Class = const C;
+		};
+		template<typename C, typename R, typename ...A>
+		struct MemberTraits<R (C::*)(A...) noexcept>
+		{
+			using Class = C;
+		};
+		template<typename C, typename R, typename ...A>
+		struct MemberTraits<R (C::*)(A...) const noexcept>
+		{
+			using Class = const C;
+		};
+	}
+
+	//
+	// a method subscribed to an event, nothing is allocated for it: the event only
+	// stores the object pointer and a function calling M on it (its arrays can grow).
+	// event.add(picoevents::member<&Panel::onChanged>(this));
+	// event.remove(picoevents::member<&Panel::onChanged>(this));
+	//
+	template<auto M>
+	struct Member
 	{
-	public:
-		ScopedCallbackIDBase() = default;
-		virtual ~ScopedCallbackIDBase() {}
+		typename detail::MemberTraits<decltype(M)>::Class* object;
 	};
+	template<auto M>
+	Member<M> member(typename detail::MemberTraits<decltype(M)>::Class* object)
+	{
+		return Member<M> { object };
+	}
+
+	class SubscriptionGroup;
+	class AsyncNotification;
 
 
 	template<typename ...T>
@@ -90,76 +1472,142 @@ namespace picoevents
 	{
 	public:
 		using Callback = std::function<void(T...)>;
-		using CallbackID = typename std::list<Callback>::iterator;
+		using CallbackID = SubscriptionID;
 
         void setEnabled(bool b)
         {
-            _enabled = b;
+            _core.setEnabled(b);
         }
         bool isEnabled() const
         {
-            return _enabled;
+            return _core.isEnabled();
         }
 
 		CallbackID empty_callback() 
 		{
-			return _callbacks.end();
+			return CallbackID();
 		}
 
-		CallbackID add(const Callback& c, bool first=false)
+		// name shown by the Registry and the StormDetector (when they are enabled)
+		void setName(const char* name)
 		{
-			if (first)
-			{
-				_callbacks.push_front(c);
-				return _callbacks.begin();
-			}
-			else
-			{
-				_callbacks.push_back(c);
-				return std::prev(_callbacks.end());
-			}
+#if defined(PICOEVENTS_EVENT_NAMES)
+			_core.setName(name);
+#else
+			(void)name;
+#endif
+		}
+
+		CallbackID add(const Callback& c, bool first=false PICOEVENTS_LOCATION_PARAM)
+		{
+			if (refusesCallback()) return CallbackID();
+			using B = detail::Boxed<Callback, T...>;
+			return _core.add(new Callback(c), B::invoker(), &B::ops, first PICOEVENTS_LOCATION_ARG);
+		}
+		// any other callable is stored as is, saving the std::function indirection
+		template<typename F, typename = typename std::enable_if<detail::IsCallable<F, Callback, T...>::value>::type>
+		CallbackID add(F&& f, bool first = false PICOEVENTS_LOCATION_PARAM)
+		{
+			if (refusesCallback()) return CallbackID();
+			using C = typename std::decay<F>::type;
+			using B = detail::Boxed<C, T...>;
+			return _core.add(new C(std::forward<F>(f)), B::invoker(), &B::ops, first PICOEVENTS_LOCATION_ARG);
+		}
+		// a method, removed in O(1) with remove(member<M>(object))
+		template<auto M>
+		CallbackID add(Member<M> m, bool first = false PICOEVENTS_LOCATION_PARAM)
+		{
+			if (refusesCallback()) return CallbackID();
+			return _core.addDelegate(const_cast<void*>(static_cast<const void*>(m.object)), reinterpret_cast<detail::EventCore::Invoke>(&invokeMember<M>), first PICOEVENTS_LOCATION_ARG);
 		}
 		void remove(CallbackID &c)
 		{
-			if (c != _callbacks.end())
-			{
-				if (c == _nextCallback)
-				{
-					_nextCallback++;
-				}
-				_callbacks.erase(c);
-				c = _callbacks.end();
-			}
+			_core.remove(c);
+		}
+		// removes one subscription of this method of this object, false if there is none
+		template<auto M>
+		bool remove(Member<M> m)
+		{
+			return _core.removeDelegate(const_cast<void*>(static_cast<const void*>(m.object)), reinterpret_cast<detail::EventCore::Invoke>(&invokeMember<M>));
 		}
 		bool replace(CallbackID id, Callback& c)
 		{
-			*id = c;
-			return true;
+			using B = detail::Boxed<Callback, T...>;
+			return _core.replace(id, new Callback(c), B::invoker(), &B::ops);
+		}
+		// moves the callback of id, muted or not, to another event without copying it.
+		// Returns its new id (in to), id becomes invalid, or an invalid id if to refuses it
+		CallbackID moveTo(CallbackID& id, Event& to, bool first = false)
+		{
+			if (&to != this && to.refusesCallback()) return CallbackID();
+			return _core.moveTo(id, to._core, first);
+		}
+		bool isValid(CallbackID id) const
+		{
+			return _core.isValid(id);
+		}
+
+		// a muted callback keeps its place but is skipped by notify()
+		void setMuted(CallbackID id, bool muted)
+		{
+			_core.setMuted(id, muted);
+		}
+		bool isMuted(CallbackID id) const
+		{
+			return _core.isMuted(id);
 		}
 
 		// overloading () so you can do event(a, b, c); instead of event.notify(a, b, c);
 		void operator()(T... t)
 		{
-			notify(t...);
+			notify(std::forward<T>(t)...);
 		}
 
+		//
+		// the arguments passed by value are copied for each callback but the last one,
+		// which gets them moved.
+		// With move-only arguments (std::unique_ptr...) the event can only have a
+		// single callback, adding a second one asserts (and fails in release builds)
+		//
 		void notify(T... t) const
 		{
-            if (_enabled)
+            if (_core.isEnabled())
             {
-                for (CallbackID c = _callbacks.begin(); c != _callbacks.end();)
-                {
-					// as erase only invalidates the current iterator,
-					// we can perform erase() while calling notify by preloading
-					// the next one
-					_nextCallback = std::next(c);
-                    (*c)(t...);
-					c = _nextCallback;
-                }
-				_nextCallback = _callbacks.end();
+				if constexpr (!MovesArgs)
+				{
+					_core.dispatch([&](const detail::EventCore::Entry& e)
+					{
+						reinterpret_cast<Invoke>(e.invoke)(e.context, t...);
+					});
+				}
+				else
+				{
+					_core.dispatchLast([&](const detail::EventCore::Entry& e, bool last)
+					{
+						if (last) reinterpret_cast<Invoke>(e.invoke)(e.context, std::forward<T>(t)...);
+						else if constexpr (CopiesArgs) reinterpret_cast<Invoke>(e.invoke)(e.context, t...);
+					});
+				}
 			}
 		}
 
+        // RAII way to temporary mute a single callback
+        class ScopedMute
+        {
+            Event& _e;
+            CallbackID _id;
+            bool _prev;
+        public:
+            ScopedMute(Event& e, CallbackID id) : _e(e), _id(id), _prev(_e.isMuted(id))
+            {
+                _e.setMuted(_id, true);
+            }
+            ~ScopedMute()
+            {
+                _e.setMuted(_id, _prev);
+            }
+        };
+
         // RAII way to temporary disable an event
         class ScopedDisable
         {
@@ -187,11 +1635,18 @@ namespace picoevents
 			}
 		public:
 			Notifier(Event& e, T... t) :
-				_t(std::tuple<T...>(t...)),
+				_t(std::forward<T>(t)...),
 				_e(e) {}
-			void trigger()
+			// can be triggered again, the arguments are copied
+			void trigger() &
+			{
+				static_assert(CopiesArgs, "move-only arguments can only be delivered once: call std::move(notifier).trigger()");
+				if constexpr (CopiesArgs) std::apply([&](auto &&... args) { _e.notify(args...); }, _t);
+			}
+			// last use, the arguments are moved
+			void trigger() &&
 			{
-				std::apply([&](auto &&... args) { _e.notify(args...); }, _t);
+				_e.notifyFrom(_t, std::index_sequence_for<T...>());
 			}
 		private:
 			tuple_with_removed_refs<T...> _t;
@@ -206,56 +1661,133 @@ namespace picoevents
                 _n(n)
             {
             }
+            ScopedNotifier(Notifier&& n) :
+                _n(std::move(n))
+            {
+            }
+            ScopedNotifier(Event& e, T... t) :
+                _n(e, std::forward<T>(t)...)
+            {
+            }
             ~ScopedNotifier()
             {
-                _n.trigger();
+                std::move(_n).trigger();
             }
         };
 
 		Notifier makeNotifier(T... t)
 		{
-			return Notifier(*this, t...);
+			return Notifier(*this, std::forward<T>(t)...);
 		}
 
+		//
+		// notifies from another thread: posts a task calling notify(t...) to executor,
+		// anything with a post(std::function<void()>) method.
+		// The arguments are copied once, the event must outlive the task and must
+		// not be modified, or notified from another thread, while it runs. An executor
+		// can also drop the task (e.g. the event is gone): the arguments are released.
+		// Defined in picoevents_async.h
+		//
+		template<typename Executor>
+		AsyncNotification notifyAsync(Executor& executor, T... t) const;
+
 		class ScopedCallbackID: public ScopedCallbackIDBase
 		{
-			Event& _event;
+			Event* _event;
 			Event::CallbackID _cb;
 		public:
-			ScopedCallbackID(Event& event, const Callback& c, bool first=false) : _event(event)
+			ScopedCallbackID(Event& event, const Callback& c, bool first=false PICOEVENTS_LOCATION_PARAM) : _event(&event)
+			{
+				_cb = _event->add(c, first PICOEVENTS_LOCATION_ARG);
+			}
+			template<typename F, typename = typename std::enable_if<detail::IsCallable<F, Callback, T...>::value>::type>
+			ScopedCallbackID(Event& event, F&& f, bool first = false PICOEVENTS_LOCATION_PARAM) : _event(&event)
+			{
+				_cb = _event->add(std::forward<F>(f), first PICOEVENTS_LOCATION_ARG);
+			}
+			template<auto M>
+			ScopedCallbackID(Event& event, Member<M> m, bool first = false PICOEVENTS_LOCATION_PARAM) : _event(&event)
 			{
-				_cb = _event.add(c, first);
+				_cb = _event->add(m, first PICOEVENTS_LOCATION_ARG);
 			}
 			ScopedCallbackID(ScopedCallbackID&& other) : _event(other._event), _cb(other._cb)
 			{
-				other._cb = _event.empty_callback();
+				other._cb = _event->empty_callback();
 			}
 			virtual ~ScopedCallbackID()
 			{
-				_event.remove(_cb);
+				_event->remove(_cb);
 			}
+			// removes the callback and adds c to event
 			void replace(Event& event, const Callback& c, bool first = false)
 			{
-				_event.remove(_cb);
-				_event = event;
-				_cb = _event.add(c, first);
+				_event->remove(_cb);
+				_event = &event;
+				_cb = _event->add(c, first);
+			}
+			// moves the same callback to event, e.g. when a panel switches document.
+			// If event refuses it the callback stays where it was, and false is returned
+			bool retarget(Event& event, bool first = false)
+			{
+				CallbackID id = _event->moveTo(_cb, event, first);
+				if (!event.isValid(id)) return false;
+				_cb = id;
+				_event = &event;
+				return true;
 			}
 			void invoke(T... t)
 			{
-				(*_cb)(t...);
+				_event->invoke(_cb, std::forward<T>(t)...);
 			}
 			Event& getEvent()
 			{
-				return _event;
+				return *_event;
 			}
 		};
 
 	private:
-		// could possibly use std::forward_list<> but then removing 
-		// callbacks becomes more tricky
-		mutable std::list<Callback> _callbacks;
-        bool _enabled = true;
-		mutable CallbackID _nextCallback = _callbacks.end();
+		using Invoke = void (*)(void*, T...);
+
+		// calls the callback of id directly (used by ScopedCallbackID::invoke)
+		void invoke(CallbackID id, T... t) const
+		{
+			if (const detail::EventCore::Entry* e = _core.find(id))
+			{
+				reinterpret_cast<Invoke>(e->invoke)(e->context, std::forward<T>(t)...);
+			}
+		}
+
+		template<auto M>
+		static void invokeMember(void* object, T... t)
+		{
+			using C = typename detail::MemberTraits<decltype(M)>::Class;
+			(static_cast<C*>(object)->*M)(std::forward<T>(t)...);
+		}
+
+		// notify() with the arguments stored in a tuple, moving those passed by value
+		template<typename Tuple, size_t... I>
+		void notifyFrom(Tuple& t, std::index_sequence<I...>) const
+		{
+			notify(std::forward<T>(std::get<I>(t))...);
+		}
+
+		// an argument passed by value is worth moving to the last callback
+		static constexpr bool MovesArgs = (... || (!std::is_reference<T>::value && !std::is_trivially_copyable<T>::value));
+		static constexpr bool CopiesArgs = (... && std::is_copy_constructible<T>::value);
+
+		// move-only arguments can't be given to several callbacks
+		bool refusesCallback() const
+		{
+			if constexpr (CopiesArgs) return false;
+			else
+			{
+				assert(_core.size() == 0 && "an Event with move-only arguments can only have one callback");
+				return _core.size() > 0;
+			}
+		}
+
+		detail::EventCore _core;
+		friend class SubscriptionGroup;
 	};
 
 
@@ -274,10 +1806,10 @@ namespace picoevents
         virtual ~ScopedCallbacksHolder()
         {
         }
-        template<typename E>
-        typename E::ScopedCallbackID* addCallback(E& e, const typename E::Callback& c, bool first = false)
+        template<typename E, typename F>
+        typename E::ScopedCallbackID* addCallback(E& e, F&& c, bool first = false PICOEVENTS_LOCATION_PARAM)
         {
-            typename E::ScopedCallbackID* res = new typename E::ScopedCallbackID(e, c, first);
+            typename E::ScopedCallbackID* res = new typename E::ScopedCallbackID(e, std::forward<F>(c), first PICOEVENTS_LOCATION_ARG);
             _callbacks.emplace_back(res);
             return res;
         }
@@ -298,9 +1830,323 @@ namespace picoevents
 			// because _callbacks contains unique_ptr, this actually deletes the original r
 			if (it != _callbacks.end()) _callbacks.erase(it);
 		}
+
+		// moves the callbacks added to from over to to, keeping their order.
+		// Returns how many were moved, the ones to refuses stay in from
+		template<typename ...T>
+		size_t retargetCallbacks(Event<T...>& from, Event<T...>& to)
+		{
+			size_t n = 0;
+			for (auto& c : _callbacks)
+			{
+				auto* id = dynamic_cast<typename Event<T...>::ScopedCallbackID*>(c.get());
+				if (id && &id->getEvent() == &from && id->retarget(to)) n++;
+			}
+			return n;
+		}
     };
 
 
+	//
+	// callbacks added to any number of events, removed or muted together,
+	// e.g. everything a document subscribed to:
+	// document.subscriptions.add(selectionChanged, [this](int i) { ... });
+	// document.subscriptions.removeAll();	// or when the group is destroyed
+	//
+	// Unlike a ScopedCallbacksHolder there is no object per callback, only an
+	// (event, id) pair in an array, removeAll() is a single pass over it.
+	// The group is linked to each of its events: an event destroyed first leaves
+	// the group, whose ids for it are then skipped like the callbacks removed from
+	// their event directly
+	//
+	class SubscriptionGroup
+	{
+	public:
+		SubscriptionGroup() = default;
+		SubscriptionGroup(const SubscriptionGroup&) = delete;
+		SubscriptionGroup& operator=(const SubscriptionGroup&) = delete;
+		SubscriptionGroup(SubscriptionGroup&& other) : _entries(std::move(other._entries)), _links(std::move(other._links)), _pruneAt(other._pruneAt), _muted(other._muted)
+		{
+			other._entries.clear();
+			other._links.clear();
+		}
+		~SubscriptionGroup()
+		{
+			removeAll();
+		}
+
+		template<typename F, typename ...T>
+		SubscriptionID add(Event<T...>& event, F&& f, bool first = false PICOEVENTS_LOCATION_PARAM)
+		{
+			SubscriptionID id = event.add(std::forward<F>(f), first PICOEVENTS_LOCATION_ARG);
+			track(event, id);
+			return id;
+		}
+		// puts in the group a callback already added to event
+		template<typename ...T>
+		void track(Event<T...>& event, SubscriptionID id)
+		{
+			if (!event._core.isValid(id)) return;
+			if (_entries.size() >= _pruneAt) prune();
+			_entries.push_back(Entry { linkTo(event._core), id });
+			if (_muted) event._core.setMuted(id, true);
+		}
+
+		void removeAll()
+		{
+			for (Entry& e : _entries) if (e.link->core) e.link->core->remove(e.id);
+			_entries.clear();
+			for (auto& l : _links) if (l->core) l->core->unlink(l.get());
+			_links.clear();
+			_pruneAt = 16;
+		}
+		// mutes or unmutes all the callbacks of the group, and the ones added later
+		void setMuted(bool muted)
+		{
+			_muted = muted;
+			for (Entry& e : _entries) if (e.link->core) e.link->core->setMuted(e.id, muted);
+		}
+		bool isMuted() const
+		{
+			return _muted;
+		}
+		// number of callbacks still subscribed
+		size_t size() const
+		{
+			size_t n = 0;
+			for (const Entry& e : _entries) n += isValid(e);
+			return n;
+		}
+
+	private:
+		struct Entry
+		{
+			detail::GroupLink* link;
+			SubscriptionID id;
+		};
+		static bool isValid(const Entry& e)
+		{
+			return e.link->core && e.link->core->isValid(e.id);
+		}
+		// the link to core, events are usually added to one after the other
+		detail::GroupLink* linkTo(detail::EventCore& core)
+		{
+			for (auto l = _links.rbegin(); l != _links.rend(); l++)
+			{
+				if ((*l)->core == &core) return l->get();
+			}
+			_links.emplace_back(new detail::GroupLink());
+			core.link(_links.back().get());
+			return _links.back().get();
+		}
+		// drops the callbacks removed directly from their events, and the destroyed events
+		void prune()
+		{
+			_entries.erase(std::remove_if(_entries.begin(), _entries.end(), [](const Entry& e) { return !isValid(e); }), _entries.end());
+			_links.erase(std::remove_if(_links.begin(), _links.end(), [](const std::unique_ptr<detail::GroupLink>& l) { return !l->core; }), _links.end());
+			_pruneAt = std::max<size_t>(16, _entries.size() * 2);
+		}
+
+		std::vector<Entry> _entries;
+		std::vector<std::unique_ptr<detail::GroupLink>> _links;	// one per event, stable addresses
+		size_t _pruneAt = 16;
+		bool _muted = false;
+	};
+
+
+	//
+	// undo / redo log for the Values that opted in with enableHistory().
+	// Each set() records the previous and the new value. Changes made while a
+	// ScopedTransaction is alive are grouped into one undo step, and a Value changed
+	// several times in the same step is only restored (and notified) once.
+	// At most maxSteps steps are kept, the oldest ones are dropped first.
+	//
+	// Recording keeps two copies of T: for big containers use a persistent type such as
+	// PersistentVector (picoevents_persistent.h), where a copy only shares the tree
+	//
+	class History
+	{
+	public:
+		explicit History(size_t maxSteps = 100) : _maxSteps(maxSteps) {}
+		History(const History&) = delete;
+		History& operator=(const History&) = delete;
+
+		// the log used by Value::enableHistory() when none is given
+		static History& global()
+		{
+			static History history;
+			return history;
+		}
+
+		void setMaxSteps(size_t n)
+		{
+			_maxSteps = n;
+			trim();
+		}
+		size_t getMaxSteps() const
+		{
+			return _maxSteps;
+		}
+		bool canUndo() const
+		{
+			return !_undo.empty();
+		}
+		bool canRedo() const
+		{
+			return !_redo.empty();
+		}
+		// true while undo() / redo() are restoring values
+		bool isReplaying() const
+		{
+			return _replaying;
+		}
+
+		bool undo()
+		{
+			return replay(_undo, _redo, true);
+		}
+		bool redo()
+		{
+			return replay(_redo, _undo, false);
+		}
+		void clear()
+		{
+			_undo.clear();
+			_redo.clear();
+		}
+
+		// RAII way to group several changes into a single undo step
+		class ScopedTransaction
+		{
+			History& _h;
+		public:
+			ScopedTransaction(History& h = History::global()) : _h(h)
+			{
+				_h._depth++;
+			}
+			~ScopedTransaction()
+			{
+				if (--_h._depth == 0 && !_h._open.empty())
+				{
+					_h.push(std::move(_h._open));
+					_h._open.clear();
+				}
+			}
+		};
+
+		// called by Value::set()
+		template<typename V, typename T>
+		void record(V& value, T before, T after)
+		{
+			_redo.clear();
+			if (_depth > 0)
+			{
+				for (auto& c : _open)
+				{
+					if (c->owner == &value)
+					{
+						static_cast<ValueChange<V, T>&>(*c).after = std::move(after);
+						return;
+					}
+				}
+				_open.emplace_back(new ValueChange<V, T>(value, std::move(before), std::move(after)));
+			}
+			else
+			{
+				Step step;
+				step.emplace_back(new ValueChange<V, T>(value, std::move(before), std::move(after)));
+				push(std::move(step));
+			}
+		}
+
+		// drops every change made to owner, called when a Value is deleted
+		void forget(const void* owner)
+		{
+			auto forgetIn = [owner](Step& step)
+			{
+				for (auto it = step.begin(); it != step.end();)
+				{
+					if ((*it)->owner == owner) it = step.erase(it);
+					else it++;
+				}
+			};
+			forgetIn(_open);
+			for (auto* steps : { &_undo, &_redo })
+			{
+				for (auto it = steps->begin(); it != steps->end();)
+				{
+					forgetIn(*it);
+					if (it->empty()) it = steps->erase(it);
+					else it++;
+				}
+			}
+		}
+
+	private:
+		struct Change
+		{
+			const void* owner;
+			Change(const void* o) : owner(o) {}
+			virtual ~Change() {}
+			virtual void restore(bool undo) = 0;
+		};
+		template<typename V, typename T>
+		struct ValueChange : Change
+		{
+			V& value;
+			T before;
+			T after;
+			ValueChange(V& v, T b, T a) : Change(&v), value(v), before(std::move(b)), after(std::move(a)) {}
+			void restore(bool undo) override
+			{
+				History::restore(value, undo ? before : after);
+			}
+		};
+		using Step = std::vector<std::unique_ptr<Change>>;
+
+		template<typename V, typename T>
+		static void restore(V& value, const T& t)
+		{
+			value.restore(t);
+		}
+
+		void push(Step&& step)
+		{
+			_undo.push_back(std::move(step));
+			trim();
+		}
+		void trim()
+		{
+			while (_undo.size() > _maxSteps) _undo.pop_front();
+		}
+		bool replay(std::deque<Step>& from, std::deque<Step>& to, bool undo)
+		{
+			if (from.empty() || _replaying) return false;
+			Step step = std::move(from.back());
+			from.pop_back();
+			_replaying = true;
+			if (undo)
+			{
+				for (auto it = step.rbegin(); it != step.rend(); it++) (*it)->restore(true);
+			}
+			else
+			{
+				for (auto& c : step) c->restore(false);
+			}
+			_replaying = false;
+			to.push_back(std::move(step));
+			return true;
+		}
+
+		std::deque<Step> _undo;
+		std::deque<Step> _redo;
+		Step _open;
+		size_t _maxSteps;
+		int _depth = 0;
+		bool _replaying = false;
+	};
+
+
 	// added listeners are removed when the value is deleted
 	// if a listener is deleted before the value, it needs to be removed with removeCallback() first !
 	template<typename T, typename ET=T>
@@ -308,26 +2154,70 @@ namespace picoevents
 	{
 		T _t;
 		Event<ET> _e;
+		History* _history = nullptr;
+		uint64_t _version = 0;
+
+		template<typename U>
+		void assign(U&& t)
+		{
+			_version++;
+			if (_history && !_history->isReplaying())
+			{
+				T before = std::move(_t);
+				_t = std::forward<U>(t);
+				_history->record(*this, std::move(before), _t);
+			}
+			else
+			{
+				_t = std::forward<U>(t);
+			}
+		}
+		// called by History::undo() / redo()
+		friend class History;
+		void restore(const T& t)
+		{
+			_t = t;
+			_version++;
+			notify();
+		}
 	public:
 		Value(const T& t) : _t(t) {}
 		virtual ~Value()
 		{
+			disableHistory();
 			removeAllCallbacks(); // remove callbacks before deleting _e
 		}
 		void set(const T& t)
 		{
-			_t = t;
+			assign(t);
 			notify();
 		}
 		void set(T&& t)
 		{
-			_t = t;
+			assign(std::move(t));
 			notify();
 		}
+
+		// opt-in: from now on set() records undo steps into h
+		void enableHistory(History& h = History::global())
+		{
+			if (_history != &h) disableHistory();
+			_history = &h;
+		}
+		void disableHistory()
+		{
+			if (_history) _history->forget(this);
+			_history = nullptr;
+		}
 		const T& get() const
 		{
 			return _t;
 		}
+		// incremented by each set() (and undo / redo), see ValueObserver
+		uint64_t version() const
+		{
+			return _version;
+		}
 		Event<ET>& getEvent()
 		{
 			return _e;
@@ -337,14 +2227,69 @@ namespace picoevents
 			_e.notify(_t);
 		}
 
-		typename Event<ET>::ScopedCallbackID* addListener(const typename Event<ET>::Callback& c, bool first = false)
+		typename Event<ET>::ScopedCallbackID* addListener(const typename Event<ET>::Callback& c, bool first = false PICOEVENTS_LOCATION_PARAM)
+		{
+			return addCallback(_e, c, first PICOEVENTS_LOCATION_ARG);
+		}
+	};
+
+
+	//
+	// polling instead of listening: tells whether a Value (or anything with a version(),
+	// like SharedValue) was set since the last time it was checked, without copying
+	// or comparing the value
+	//
+	template<typename V>
+	class ValueObserver
+	{
+		const V& _v;
+		uint64_t _seen;
+	public:
+		ValueObserver(const V& v) : _v(v), _seen(v.version()) {}
+
+		bool changedSince(uint64_t version) const
+		{
+			return _v.version() != version;
+		}
+		bool changed() const
+		{
+			return changedSince(_seen);
+		}
+		// true if it changed since the previous call (or the creation of the observer)
+		bool poll()
+		{
+			uint64_t v = _v.version();
+			if (v == _seen) return false;
+			_seen = v;
+			return true;
+		}
+		uint64_t seenVersion() const
 		{
-			return addCallback(_e, c, first);
+			return _seen;
 		}
 	};
 }
 
 
+//
+// Every translation unit using an Event<...> instantiates its whole implementation.
+// To compile the most common ones only once, define PICOEVENTS_EXTERN_TEMPLATES
+// for the whole project and add picoevents.cpp to it.
+// Other signatures can be declared the same way with PICOEVENTS_EXTERN_EVENT(...)
+// in a header, and PICOEVENTS_INSTANTIATE_EVENT(...) in one source file.
+//
+#define PICOEVENTS_EXTERN_EVENT(...) extern template class picoevents::Event<__VA_ARGS__>;
+#define PICOEVENTS_INSTANTIATE_EVENT(...) template class picoevents::Event<__VA_ARGS__>;
+
+#if defined(PICOEVENTS_EXTERN_TEMPLATES)
+#include <string>
+PICOEVENTS_EXTERN_EVENT()
+PICOEVENTS_EXTERN_EVENT(int)
+PICOEVENTS_EXTERN_EVENT(bool)
+PICOEVENTS_EXTERN_EVENT(const std::string&)
+#endif
+
+
 // Example code below
 #if 0
 
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#if defined(PICOEVENTS_ALLOCATION_COUNTER_IMPLEMENTATION) && defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+/*
+ Checking that notifications don't allocate
+
+ // in one source file of the test executable, replaces the global operator new / delete
+ // (or link to the picoevents_allocation_counter target of tests/CMakeLists.txt)
+ #define PICOEVENTS_ALLOCATION_COUNTER_IMPLEMENTATION
+ #include "picoevents_allocations.h"
+
+ {
+	picoevents::ScopedAllocationBudget budget("notify", 0);
+	valueChangedEvent.notify(42);
+ }	// reports (and aborts) if notify() allocated
+
+ picoevents::ScopedAllocationCount count;
+ value.set(12);
+ printf("%zu allocations, %zu bytes\n", count.get().allocations, count.get().bytes);
+
+ The counts are per thread: other threads allocating meanwhile don't matter.
+ Without PICOEVENTS_ALLOCATION_COUNTER_IMPLEMENTATION in the executable nothing is
+ counted (the counts stay at 0).
+*/
+
+namespace picoevents
+{
+	class AllocationCounter
+	{
+	public:
+		struct Counts
+		{
+			size_t allocations = 0;
+			size_t bytes = 0;
+			size_t frees = 0;
+		};
+
+		// made by the calling thread since it started
+		static Counts current()
+		{
+			return counts();
+		}
+
+		// called by the replaced operator new / delete
+		static void allocated(size_t bytes)
+		{
+			Counts& c = counts();
+			c.allocations++;
+			c.bytes += bytes;
+		}
+		static void freed()
+		{
+			counts().frees++;
+		}
+
+	private:
+		static Counts& counts()
+		{
+			thread_local Counts c;
+			return c;
+		}
+	};
+
+	// what the current thread allocated since the creation of the object
+	class ScopedAllocationCount
+	{
+		AllocationCounter::Counts _start;
+	public:
+		ScopedAllocationCount() : _start(AllocationCounter::current()) {}
+		AllocationCounter::Counts get() const
+		{
+			AllocationCounter::Counts now = AllocationCounter::current();
+			AllocationCounter::Counts res;
+			res.allocations = now.allocations - _start.allocations;
+			res.bytes = now.bytes - _start.bytes;
+			res.frees = now.frees - _start.frees;
+			return res;
+		}
+	};
+
+	//
+	// calls the handler when the scope made more than maxAllocations allocations.
+	// The default handler prints the scope name and aborts, so that a test
+	// adding an allocation to a hot path fails
+	//
+	class ScopedAllocationBudget
+	{
+	public:
+		using Handler = void (*)(const char* name, size_t allocations, size_t maxAllocations);
+
+		ScopedAllocationBudget(const char* name, size_t maxAllocations) : _name(name), _max(maxAllocations) {}
+		ScopedAllocationBudget(const ScopedAllocationBudget&) = delete;
+		ScopedAllocationBudget& operator=(const ScopedAllocationBudget&) = delete;
+		~ScopedAllocationBudget()
+		{
+			size_t n = _count.get().allocations;
+			if (n > _max) handler()(_name, n, _max);
+		}
+
+		static void setHandler(Handler h)
+		{
+			handler() = h ? h : &defaultHandler;
+		}
+
+	private:
+		static void defaultHandler(const char* name, size_t allocations, size_t maxAllocations)
+		{
+			fprintf(stderr, "picoevents: %s made %zu allocations, %zu allowed\n", name, allocations, maxAllocations);
+			std::abort();
+		}
+		static Handler& handler()
+		{
+			static Handler h = &defaultHandler;
+			return h;
+		}
+
+		const char* _name;
+		size_t _max;
+		ScopedAllocationCount _count;
+	};
+}
+
+#if defined(PICOEVENTS_ALLOCATION_COUNTER_IMPLEMENTATION)
+void* operator new(size_t size)
+{
+	picoevents::AllocationCounter::allocated(size);
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+void* operator new(size_t size, std::align_val_t align)
+{
+	picoevents::AllocationCounter::allocated(size);
+	size_t a = (size_t)align;
+	size_t rounded = size ? (size + a - 1) / a * a : a;
+	// std::aligned_alloc doesn't exist on MSVC, its blocks are freed with _aligned_free
+#if defined(_MSC_VER)
+	if (void* p = _aligned_malloc(rounded, a)) return p;
+#else
+	if (void* p = std::aligned_alloc(a, rounded)) return p;
+#endif
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size, std::align_val_t align)
+{
+	return operator new(size, align);
+}
+void operator delete(void* p) noexcept
+{
+	if (!p) return;
+	picoevents::AllocationCounter::freed();
+	std::free(p);
+}
+void operator delete[](void* p) noexcept
+{
+	operator delete(p);
+}
+void operator delete(void* p, size_t) noexcept
+{
+	operator delete(p);
+}
+void operator delete[](void* p, size_t) noexcept
+{
+	operator delete(p);
+}
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	if (!p) return;
+	picoevents::AllocationCounter::freed();
+#if defined(_MSC_VER)
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+void operator delete[](void* p, std::align_val_t align) noexcept
+{
+	operator delete(p, align);
+}
+void operator delete(void* p, size_t, std::align_val_t align) noexcept
+{
+	operator delete(p, align);
+}
+void operator delete[](void* p, size_t, std::align_val_t align) noexcept
+{
+	operator delete(p, align);
+}
+#endif
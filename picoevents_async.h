@@ -0,0 +1,256 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "picoevents.h"
+
+/*
+ Notifying an event from another thread, on an executor
+
+ picoevents::AsyncNotification done = valueChangedEvent.notifyAsync(executor, 42);
+ ...
+ done.wait();                   // or poll done.isDone()
+
+ Event::notifyAsync() is declared by picoevents.h and defined here, so that the
+ files that only notify synchronously don't include the threading headers.
+ The arguments are copied once into a ref-counted state, taken from a free list
+ per argument types, whatever the number of callbacks. The whole fan-out runs in
+ the one task posted to the executor.
+*/
+
+namespace picoevents
+{
+	namespace detail
+	{
+		// shared by an asynchronous notification and its AsyncNotification handles
+		class AsyncState
+		{
+		public:
+			void retain()
+			{
+				_refs.fetch_add(1, std::memory_order_relaxed);
+			}
+			void release()
+			{
+				if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) _recycle(this);
+			}
+			void complete()
+			{
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					_done.store(true, std::memory_order_release);
+				}
+				_cv.notify_all();
+			}
+			bool isDone() const
+			{
+				return _done.load(std::memory_order_acquire);
+			}
+			void wait()
+			{
+				if (isDone()) return;
+				std::unique_lock<std::mutex> lock(_mutex);
+				_cv.wait(lock, [this] { return isDone(); });
+			}
+
+		protected:
+			AsyncState(void (*recycle)(AsyncState*)) : _recycle(recycle) {}
+			~AsyncState() = default;
+			void reset()
+			{
+				_refs.store(1, std::memory_order_relaxed);
+				_done.store(false, std::memory_order_relaxed);
+			}
+
+		private:
+			std::atomic<int> _refs { 1 };
+			std::atomic<bool> _done { false };
+			std::mutex _mutex;
+			std::condition_variable _cv;
+			void (*_recycle)(AsyncState*);
+		};
+
+		//
+		// the arguments of an asynchronous notification, stored once whatever the number of callbacks.
+		// Released states are kept in a free list (per argument types) and reused
+		//
+		template<typename ...T>
+		class AsyncArgs : public AsyncState
+		{
+		public:
+			using Tuple = std::tuple<typename std::remove_reference<T>::type...>;
+
+			// returned with one reference
+			static AsyncArgs* acquire(T... t)
+			{
+				AsyncArgs* s = nullptr;
+				{
+					Pool& p = pool();
+					std::lock_guard<std::mutex> lock(p.mutex);
+					if (!p.free.empty())
+					{
+						s = p.free.back();
+						p.free.pop_back();
+					}
+				}
+				if (s) s->reset();
+				else s = new AsyncArgs();
+				new (s->_storage) Tuple(std::forward<T>(t)...);
+				return s;
+			}
+			Tuple& args()
+			{
+				return *reinterpret_cast<Tuple*>(_storage);
+			}
+
+		private:
+			static constexpr size_t MaxPooled = 64;
+			struct Pool
+			{
+				std::mutex mutex;
+				std::vector<AsyncArgs*> free;
+				~Pool()
+				{
+					for (AsyncArgs* s : free) delete s;
+				}
+			};
+			static Pool& pool()
+			{
+				static Pool p;
+				return p;
+			}
+			static void recycle(AsyncState* state)
+			{
+				AsyncArgs* s = static_cast<AsyncArgs*>(state);
+				s->args().~Tuple();
+				{
+					Pool& p = pool();
+					std::lock_guard<std::mutex> lock(p.mutex);
+					if (p.free.size() < MaxPooled)
+					{
+						p.free.push_back(s);
+						return;
+					}
+				}
+				delete s;
+			}
+
+			AsyncArgs() : AsyncState(&recycle) {}
+			alignas(Tuple) unsigned char _storage[sizeof(Tuple)];
+		};
+	}
+
+
+	//
+	// handle on a notification started with Event::notifyAsync(),
+	// done once all the callbacks have been called
+	//
+	class AsyncNotification
+	{
+		detail::AsyncState* _state = nullptr;
+	public:
+		AsyncNotification() = default;
+		// takes over one reference
+		explicit AsyncNotification(detail::AsyncState* state) : _state(state) {}
+		AsyncNotification(const AsyncNotification& other) : _state(other._state)
+		{
+			if (_state) _state->retain();
+		}
+		AsyncNotification(AsyncNotification&& other) : _state(other._state)
+		{
+			other._state = nullptr;
+		}
+		AsyncNotification& operator=(AsyncNotification other)
+		{
+			std::swap(_state, other._state);
+			return *this;
+		}
+		~AsyncNotification()
+		{
+			if (_state) _state->release();
+		}
+
+		bool isValid() const
+		{
+			return _state != nullptr;
+		}
+		bool isDone() const
+		{
+			return !_state || _state->isDone();
+		}
+		// blocks until the notification is done
+		void wait() const
+		{
+			if (_state) _state->wait();
+		}
+	};
+
+
+	template<typename ...T>
+	template<typename Executor>
+	AsyncNotification Event<T...>::notifyAsync(Executor& executor, T... t) const
+	{
+		using State = detail::AsyncArgs<T...>;
+		// the task's reference, released with the task even when the executor
+		// drops it without running it
+		struct Ref
+		{
+			State* s;
+			explicit Ref(State* state) : s(state)
+			{
+				s->retain();
+			}
+			Ref(const Ref& other) : s(other.s)
+			{
+				s->retain();
+			}
+			Ref& operator=(const Ref&) = delete;
+			~Ref()
+			{
+				s->release();
+			}
+		};
+		State* s = State::acquire(std::forward<T>(t)...);
+		AsyncNotification handle(s);
+		executor.post(std::function<void()>([this, ref = Ref(s)]
+		{
+			notifyFrom(ref.s->args(), std::index_sequence_for<T...>());
+			ref.s->complete();
+		}));
+		return handle;
+	}
+}
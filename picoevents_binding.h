@@ -0,0 +1,220 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "picoevents.h"
+
+/*
+ Two-way bindings between Values
+
+ picoevents::Value<float> celsius(20.f);
+ picoevents::Value<float> fahrenheit(0.f);
+ auto binding = picoevents::bind(celsius, fahrenheit,
+	[](float c) { return c * 9.f / 5.f + 32.f; },
+	[](float f) { return (f - 32.f) * 5.f / 9.f; });
+ // fahrenheit is now 68, and each change of one value is propagated
+ // exactly once to the other one
+
+ Each change starts a propagation with its own token, a value already
+ reached by the current token is not set again (a value set by a listener
+ during a propagation, not by a binding, starts its own one), so a binding never echoes
+ back to the value that triggered it and the other listeners of both
+ values are not silenced (as they would be with Event::ScopedDisable).
+ bind() refuses (returns nullptr) a binding that would close a cycle in
+ the graph of bindings, as the values of a cycle could disagree.
+
+ The binding must be deleted before the values it connects.
+*/
+
+namespace picoevents
+{
+	// keeps track of which values are bound together, and of the current propagation
+	class BindingGraph
+	{
+	public:
+		BindingGraph() = default;
+		BindingGraph(const BindingGraph&) = delete;
+		BindingGraph& operator=(const BindingGraph&) = delete;
+
+		// the graph used by bind() when none is given
+		static BindingGraph& global()
+		{
+			static BindingGraph graph;
+			return graph;
+		}
+
+		// true if a path of bindings goes from a to b
+		bool connected(const void* a, const void* b) const
+		{
+			if (a == b) return true;
+			std::vector<const void*> todo { a };
+			std::vector<const void*> seen { a };
+			while (!todo.empty())
+			{
+				auto it = _nodes.find(todo.back());
+				todo.pop_back();
+				if (it == _nodes.end()) continue;
+				for (const void* next : it->second.links)
+				{
+					if (next == b) return true;
+					if (std::find(seen.begin(), seen.end(), next) == seen.end())
+					{
+						seen.push_back(next);
+						todo.push_back(next);
+					}
+				}
+			}
+			return false;
+		}
+
+		// called by the bindings
+		void link(const void* a, const void* b)
+		{
+			_nodes[a].links.push_back(b);
+			_nodes[b].links.push_back(a);
+		}
+		void unlink(const void* a, const void* b)
+		{
+			unlinkOneWay(a, b);
+			unlinkOneWay(b, a);
+		}
+		// calls f() to set 'to' after 'from' changed, unless 'to' was already
+		// reached by the current propagation
+		template<typename F>
+		void propagate(const void* from, const void* to, F&& f)
+		{
+			uint64_t token;
+			if (!_stack.empty() && _stack.back().target == from)
+			{
+				// from is being set by the current propagation
+				token = _stack.back().token;
+			}
+			else
+			{
+				// from changed on its own (maybe set by a listener
+				// during another propagation), start a new propagation
+				token = ++_token;
+				_nodes[from].token = token;
+			}
+			Node& n = _nodes[to];
+			if (n.token == token) return;
+			n.token = token;
+			_stack.push_back(Frame { token, to });
+			f();
+			_stack.pop_back();
+		}
+
+	private:
+		struct Node
+		{
+			std::vector<const void*> links;
+			uint64_t token = 0;
+		};
+		// a value being set by a binding
+		struct Frame
+		{
+			uint64_t token;
+			const void* target;
+		};
+
+		void unlinkOneWay(const void* a, const void* b)
+		{
+			auto it = _nodes.find(a);
+			if (it == _nodes.end()) return;
+			auto& links = it->second.links;
+			auto l = std::find(links.begin(), links.end(), b);
+			if (l != links.end()) links.erase(l);
+			if (links.empty()) _nodes.erase(it);
+		}
+
+		std::unordered_map<const void*, Node> _nodes;
+		uint64_t _token = 0;
+		std::vector<Frame> _stack;
+	};
+
+
+	// removes the binding from its graph (and stops propagating) when deleted
+	class Binding : public ScopedCallbackIDBase
+	{
+	protected:
+		BindingGraph& _graph;
+		const void* _a;
+		const void* _b;
+		Binding(BindingGraph& g, const void* a, const void* b) : _graph(g), _a(a), _b(b)
+		{
+			_graph.link(_a, _b);
+		}
+	public:
+		virtual ~Binding()
+		{
+			_graph.unlink(_a, _b);
+		}
+	};
+
+
+	template<typename A, typename AE, typename B, typename BE>
+	class ValueBinding : public Binding
+	{
+		typename Event<AE>::ScopedCallbackID _onA;
+		typename Event<BE>::ScopedCallbackID _onB;
+	public:
+		template<typename Conv, typename Inv>
+		ValueBinding(BindingGraph& g, Value<A, AE>& a, Value<B, BE>& b, Conv toB, Inv toA) :
+			Binding(g, &a, &b),
+			_onA(a.getEvent(), [&g, &a, &b, toB](AE v) { g.propagate(&a, &b, [&] { b.set(toB(v)); }); }),
+			_onB(b.getEvent(), [&g, &a, &b, toA](BE v) { g.propagate(&b, &a, [&] { a.set(toA(v)); }); })
+		{
+		}
+	};
+
+
+	// binds a and b: b takes the (converted) value of a, then a change of either
+	// value is propagated to the other one.
+	// Returns nullptr if a and b are already connected through other bindings
+	template<typename A, typename AE, typename B, typename BE, typename Conv, typename Inv>
+	std::unique_ptr<Binding> bind(Value<A, AE>& a, Value<B, BE>& b, Conv toB, Inv toA, BindingGraph& g = BindingGraph::global())
+	{
+		if (g.connected(&a, &b)) return nullptr;
+		std::unique_ptr<Binding> res(new ValueBinding<A, AE, B, BE>(g, a, b, toB, toA));
+		g.propagate(&a, &b, [&] { b.set(toB(a.get())); });
+		return res;
+	}
+
+	template<typename T, typename ET>
+	std::unique_ptr<Binding> bind(Value<T, ET>& a, Value<T, ET>& b, BindingGraph& g = BindingGraph::global())
+	{
+		auto same = [](const T& t) { return t; };
+		return bind(a, b, same, same, g);
+	}
+}
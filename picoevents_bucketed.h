@@ -0,0 +1,302 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "picoevents.h"
+
+/*
+ An Event for large fan-outs of a few callable types
+
+ picoevents::BucketedEvent<float> frameStarted;
+ for (auto& sprite : sprites) frameStarted.add([&sprite](float dt) { sprite.update(dt); });
+ frameStarted.notify(dt);
+
+ The callbacks are grouped by type: each type has its own bucket, a contiguous
+ array of the callables, and notify() calls them in a loop where the call is
+ direct (and can be inlined), instead of going through a different function
+ pointer for each callback. Use it when many callbacks share the same few lambda
+ types, the notification order is then by bucket (in order of creation),
+ then by order of addition in the bucket.
+ Same rules as Event for the callbacks added or removed while notifying, but
+ no muting, no add(first) and no copy.
+*/
+
+namespace picoevents
+{
+	template<typename ...T>
+	class BucketedEvent
+	{
+	public:
+		using Callback = std::function<void(T...)>;
+		using CallbackID = SubscriptionID;
+
+		BucketedEvent() = default;
+		BucketedEvent(const BucketedEvent&) = delete;
+		BucketedEvent& operator=(const BucketedEvent&) = delete;
+
+		void setEnabled(bool b)
+		{
+			_enabled = b;
+		}
+		bool isEnabled() const
+		{
+			return _enabled;
+		}
+
+		CallbackID empty_callback()
+		{
+			return CallbackID();
+		}
+
+		template<typename F, typename = typename std::enable_if<std::is_invocable<typename std::decay<F>::type&, T...>::value>::type>
+		CallbackID add(F&& f)
+		{
+			using C = typename std::decay<F>::type;
+			Bucket<C>& b = bucket<C>();
+			uint32_t slot = newSlot();
+			_slots[slot].bucket = &b;
+			_slots[slot].index = b.add(std::forward<F>(f), slot, _depth > 0);
+			_slots[slot].pending = _depth > 0;
+			_pendingAdd |= _depth > 0;
+			return CallbackID { slot, _slots[slot].generation };
+		}
+		void remove(CallbackID& id)
+		{
+			if (isValid(id))
+			{
+				Slot& s = _slots[id.slot];
+				s.bucket->kill(s.index, s.pending);
+				s.bucket = nullptr;
+				s.generation++;
+				_freeSlots.push_back(id.slot);
+				if (_depth == 0) compact(false);
+				else _pendingDelete = true;
+			}
+			id = CallbackID();
+		}
+		bool isValid(CallbackID id) const
+		{
+			return id.slot < _slots.size() && _slots[id.slot].bucket && _slots[id.slot].generation == id.generation;
+		}
+		// number of callbacks
+		size_t size() const
+		{
+			return _slots.size() - _freeSlots.size();
+		}
+
+		// overloading () so you can do event(a, b, c); instead of event.notify(a, b, c);
+		void operator()(T... t)
+		{
+			notify(t...);
+		}
+
+		void notify(T... t) const
+		{
+			if (!_enabled) return;
+			_depth++;
+			// a callback can add a new type, and so a new bucket: only the
+			// buckets that existed before are notified
+			size_t n = _buckets.size();
+			for (size_t i = 0; i < n; i++) _buckets[i]->notify(t...);
+			if (--_depth == 0 && (_pendingDelete || _pendingAdd)) compact(true);
+		}
+
+		class ScopedCallbackID : public ScopedCallbackIDBase
+		{
+			BucketedEvent& _event;
+			CallbackID _cb;
+		public:
+			template<typename F>
+			ScopedCallbackID(BucketedEvent& event, F&& f) : _event(event)
+			{
+				_cb = _event.add(std::forward<F>(f));
+			}
+			ScopedCallbackID(ScopedCallbackID&& other) : _event(other._event), _cb(other._cb)
+			{
+				other._cb = CallbackID();
+			}
+			virtual ~ScopedCallbackID()
+			{
+				_event.remove(_cb);
+			}
+			BucketedEvent& getEvent()
+			{
+				return _event;
+			}
+		};
+
+	private:
+		struct BucketBase;
+		struct Slot
+		{
+			BucketBase* bucket = nullptr;			// nullptr when free
+			uint32_t index = 0;						// in the bucket (or its pending callables)
+			uint32_t generation = 0;
+			bool pending = false;
+		};
+
+		struct BucketBase
+		{
+			const void* type;
+			size_t dead = 0;
+			BucketBase(const void* t) : type(t) {}
+			virtual ~BucketBase() = default;
+			virtual void notify(T... t) = 0;
+			virtual void kill(uint32_t index, bool pending) = 0;
+			// drops the removed callables (if there are enough of them), appends the pending ones
+			virtual void compact(std::vector<Slot>& slots, bool force) = 0;
+		};
+
+		template<typename C>
+		struct Bucket : BucketBase
+		{
+			std::vector<C> callables;
+			std::vector<uint8_t> alive;
+			std::vector<uint32_t> slotOf;
+			// added while notifying, callables can't be moved meanwhile
+			std::vector<C> pendingCallables;
+			std::vector<uint8_t> pendingAlive;
+			std::vector<uint32_t> pendingSlotOf;
+
+			Bucket() : BucketBase(typeKey<C>()) {}
+
+			template<typename F>
+			uint32_t add(F&& f, uint32_t slot, bool pending)
+			{
+				auto& c = pending ? pendingCallables : callables;
+				c.emplace_back(std::forward<F>(f));
+				(pending ? pendingAlive : alive).push_back(1);
+				(pending ? pendingSlotOf : slotOf).push_back(slot);
+				return (uint32_t)(c.size() - 1);
+			}
+			void notify(T... t) override
+			{
+				size_t n = callables.size();
+				C* c = callables.data();
+				const uint8_t* a = alive.data();
+				for (size_t i = 0; i < n; i++)
+				{
+					if (a[i]) c[i](t...);
+				}
+			}
+			void kill(uint32_t index, bool pending) override
+			{
+				if (pending) pendingAlive[index] = 0;
+				else
+				{
+					alive[index] = 0;
+					this->dead++;
+				}
+			}
+			void compact(std::vector<Slot>& slots, bool force) override
+			{
+				if (this->dead && (force || this->dead > callables.size() / 2))
+				{
+					// closures are not assignable, the live ones are moved to a new array
+					std::vector<C> kept;
+					kept.reserve(callables.size() - this->dead);
+					size_t n = 0;
+					for (size_t i = 0; i < callables.size(); i++)
+					{
+						if (!alive[i]) continue;
+						kept.push_back(std::move(callables[i]));
+						slotOf[n] = slotOf[i];
+						slots[slotOf[n]].index = (uint32_t)n;
+						n++;
+					}
+					callables = std::move(kept);
+					alive.assign(n, 1);
+					slotOf.resize(n);
+					this->dead = 0;
+				}
+				for (size_t i = 0; i < pendingCallables.size(); i++)
+				{
+					if (!pendingAlive[i]) continue;
+					callables.push_back(std::move(pendingCallables[i]));
+					alive.push_back(1);
+					slotOf.push_back(pendingSlotOf[i]);
+					Slot& s = slots[pendingSlotOf[i]];
+					s.index = (uint32_t)(callables.size() - 1);
+					s.pending = false;
+				}
+				pendingCallables.clear();
+				pendingAlive.clear();
+				pendingSlotOf.clear();
+			}
+		};
+
+		template<typename C>
+		static const void* typeKey()
+		{
+			static const char key = 0;
+			return &key;
+		}
+		template<typename C>
+		Bucket<C>& bucket()
+		{
+			for (auto& b : _buckets)
+			{
+				if (b->type == typeKey<C>()) return static_cast<Bucket<C>&>(*b);
+			}
+			_buckets.emplace_back(new Bucket<C>());
+			return static_cast<Bucket<C>&>(*_buckets.back());
+		}
+		uint32_t newSlot()
+		{
+			if (_freeSlots.empty())
+			{
+				_slots.push_back(Slot());
+				return (uint32_t)(_slots.size() - 1);
+			}
+			uint32_t slot = _freeSlots.back();
+			_freeSlots.pop_back();
+			return slot;
+		}
+		void compact(bool force) const
+		{
+			for (auto& b : _buckets) b->compact(_slots, force);
+			_pendingDelete = false;
+			_pendingAdd = false;
+		}
+
+		// mutable as a notification applies the changes made while it was running
+		std::vector<std::unique_ptr<BucketBase>> _buckets;
+		mutable std::vector<Slot> _slots;
+		std::vector<uint32_t> _freeSlots;
+		mutable int _depth = 0;
+		mutable bool _pendingDelete = false;
+		mutable bool _pendingAdd = false;
+		bool _enabled = true;
+	};
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+#include "picoevents.h"
+
+/*
+ Point to point notifications between two threads
+
+ picoevents::Channel<int, float> frames(1024);
+ frames.addListener([](int index, float time) { ... });
+
+ // producer thread (the decoder)
+ frames.push(12, 0.5f);
+
+ // consumer thread (the renderer), notifies the listeners for each message
+ frames.dispatch();
+ // or, without going through the event
+ frames.consume([](int index, float time) { ... }, 64);
+
+ A fixed size ring of std::tuple<T...>, wait-free for one producer and one
+ consumer thread: each side only writes its own index and reads the other one
+ when its cached copy says the ring is full (or empty), the consumer publishes
+ the messages it read once per batch.
+ With Wakeup::Notify the consumer can block in wait() until something is
+ pushed, the producer then only takes a lock when the consumer is waiting.
+ The listeners are called on the consumer thread, the usual Event rules apply.
+*/
+
+namespace picoevents
+{
+	template<typename ...T>
+	class Channel : public ScopedCallbacksHolder
+	{
+	public:
+		using Callback = typename Event<T...>::Callback;
+		using Message = std::tuple<typename std::decay<T>::type...>;
+		enum class Wakeup { None, Notify };
+
+		// capacity is rounded up to a power of 2
+		explicit Channel(size_t capacity, Wakeup wakeup = Wakeup::None) : _wakeup(wakeup)
+		{
+			size_t c = 1;
+			while (c < capacity) c <<= 1;
+			_mask = c - 1;
+			_messages.reset(static_cast<Message*>(::operator new(c * sizeof(Message), std::align_val_t(alignof(Message)))));
+		}
+		Channel(const Channel&) = delete;
+		Channel& operator=(const Channel&) = delete;
+		virtual ~Channel()
+		{
+			removeAllCallbacks(); // remove callbacks before deleting _e
+			consume([](auto&&...) {});
+		}
+
+		size_t capacity() const
+		{
+			return _mask + 1;
+		}
+
+		//
+		// producer side
+		//
+
+		// false if the channel is full (the arguments are then dropped)
+		bool tryPush(T... t)
+		{
+			return tryEmplace(std::forward<T>(t)...);
+		}
+		// yields until there is room
+		void push(T... t)
+		{
+			while (!tryEmplace(std::forward<T>(t)...)) std::this_thread::yield();
+		}
+
+		//
+		// consumer side
+		//
+
+		// calls f(t...) for at most max messages, returns how many were consumed
+		// (the message elements are lvalues, f can move them out)
+		template<typename F>
+		size_t consume(F&& f, size_t max = SIZE_MAX)
+		{
+			size_t tail = _tail.load(std::memory_order_relaxed);
+			if (_cachedHead == tail) _cachedHead = _head.load(std::memory_order_acquire);
+			size_t n = std::min(_cachedHead - tail, max);
+			for (size_t i = 0; i < n; i++)
+			{
+				Message& m = _messages.get()[(tail + i) & _mask];
+				std::apply(f, m);
+				m.~Message();
+			}
+			if (n) _tail.store(tail + n, std::memory_order_release);
+			return n;
+		}
+		// notifies the listeners for at most max messages, the elements moved
+		// into the arguments taken by value
+		size_t dispatch(size_t max = SIZE_MAX)
+		{
+			return consume([this](auto&... t) { _e.notify(std::forward<T>(t)...); }, max);
+		}
+		bool empty() const
+		{
+			return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_relaxed);
+		}
+		// blocks until a message can be consumed (Wakeup::Notify only)
+		void wait()
+		{
+			if (!empty()) return;
+			std::unique_lock<std::mutex> lock(_mutex);
+			_waiting.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			_cv.wait(lock, [this] { return !empty(); });
+			_waiting.store(false, std::memory_order_relaxed);
+		}
+
+		Event<T...>& getEvent()
+		{
+			return _e;
+		}
+		typename Event<T...>::ScopedCallbackID* addListener(const Callback& c, bool first = false PICOEVENTS_LOCATION_PARAM)
+		{
+			return addCallback(_e, c, first PICOEVENTS_LOCATION_ARG);
+		}
+
+	private:
+		// the arguments are only moved from (or copied) when there is room,
+		// so that push can retry with the same ones
+		template<typename ...A>
+		bool tryEmplace(A&&... a)
+		{
+			size_t head = _head.load(std::memory_order_relaxed);
+			if (head - _cachedTail > _mask)
+			{
+				_cachedTail = _tail.load(std::memory_order_acquire);
+				if (head - _cachedTail > _mask) return false;
+			}
+			new (&_messages.get()[head & _mask]) Message(std::forward<A>(a)...);
+			_head.store(head + 1, std::memory_order_release);
+			if (_wakeup == Wakeup::Notify)
+			{
+				// orders the head store before reading _waiting, see wait()
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (!_waiting.load(std::memory_order_relaxed)) return true;
+				std::lock_guard<std::mutex> lock(_mutex);
+				_cv.notify_one();
+			}
+			return true;
+		}
+
+		struct Free
+		{
+			void operator()(Message* m) const
+			{
+				::operator delete(m, std::align_val_t(alignof(Message)));
+			}
+		};
+
+		// written by the producer
+		alignas(64) std::atomic<size_t> _head { 0 };
+		size_t _cachedTail = 0;
+		// written by the consumer
+		alignas(64) std::atomic<size_t> _tail { 0 };
+		size_t _cachedHead = 0;
+		std::atomic<bool> _waiting { false };
+
+		alignas(64) size_t _mask;
+		std::unique_ptr<Message, Free> _messages;
+		Wakeup _wakeup;
+		std::mutex _mutex;
+		std::condition_variable _cv;
+		Event<T...> _e;
+	};
+}
@@ -0,0 +1,406 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include "picoevents.h"
+
+/*
+ Observable containers: instead of "the whole vector changed", listeners
+ receive a diff describing what was inserted, erased, updated or moved,
+ so that a view can apply O(k) updates instead of rebuilding itself.
+
+ picoevents::ValueVector<std::string> rows;
+ rows.addListener([&](const picoevents::VectorDiff& diff)
+ {
+	for (auto& c : diff.changes) { ... c.op, c.index, c.count ... }
+ });
+ {
+	picoevents::ValueVector<std::string>::ScopedBatch batch(rows);
+	rows.push_back("a");
+	rows.push_back("b");   // merged with the previous insert
+	rows.update(0, "c");
+ } // listeners are notified once here
+
+ Changes are listed in the order they were applied, each index being
+ relative to the container after the previous changes.
+*/
+
+namespace picoevents
+{
+	struct VectorDiff
+	{
+		enum class Op { Insert, Erase, Update, Move };
+		struct Change
+		{
+			Op op;
+			size_t index;	// first element (source for Move)
+			size_t count;
+			size_t to;		// Move only: destination of the first element, after removal from index
+		};
+		std::vector<Change> changes;
+
+		bool empty() const
+		{
+			return changes.empty();
+		}
+		void clear()
+		{
+			changes.clear();
+		}
+		// appends a change, merging it with the last one when they are contiguous
+		void add(Op op, size_t index, size_t count, size_t to = 0)
+		{
+			if (count == 0) return;
+			if (!changes.empty() && op != Op::Move)
+			{
+				Change& last = changes.back();
+				if (last.op == op)
+				{
+					switch (op)
+					{
+					case Op::Insert:
+						if (index >= last.index && index <= last.index + last.count)
+						{
+							last.count += count;
+							return;
+						}
+						break;
+					case Op::Erase:
+						if (index == last.index)
+						{
+							last.count += count;
+							return;
+						}
+						if (index + count == last.index)
+						{
+							last.index = index;
+							last.count += count;
+							return;
+						}
+						break;
+					case Op::Update:
+						if (index <= last.index + last.count && index + count >= last.index)
+						{
+							size_t end = std::max(index + count, last.index + last.count);
+							last.index = std::min(index, last.index);
+							last.count = end - last.index;
+							return;
+						}
+						break;
+					default:
+						break;
+					}
+				}
+				else if (op == Op::Update && last.op == Op::Insert
+					&& index >= last.index && index + count <= last.index + last.count)
+				{
+					// updating freshly inserted elements, the insert already covers it
+					return;
+				}
+			}
+			changes.push_back({ op, index, count, to });
+		}
+	};
+
+
+	// a std::vector<T> notifying VectorDiff
+	// added listeners are removed when the container is deleted
+	template<typename T>
+	class ValueVector : public ScopedCallbacksHolder
+	{
+		std::vector<T> _v;
+		Event<const VectorDiff&> _e;
+		VectorDiff _pending;
+		int _batch = 0;
+
+		void changed(VectorDiff::Op op, size_t index, size_t count, size_t to = 0)
+		{
+			_pending.add(op, index, count, to);
+			if (_batch == 0) flush();
+		}
+	public:
+		using Callback = typename Event<const VectorDiff&>::Callback;
+
+		ValueVector() = default;
+		ValueVector(std::vector<T> v) : _v(std::move(v)) {}
+		virtual ~ValueVector()
+		{
+			removeAllCallbacks(); // remove callbacks before deleting _e
+		}
+
+		const std::vector<T>& get() const
+		{
+			return _v;
+		}
+		const T& operator[](size_t i) const
+		{
+			return _v[i];
+		}
+		size_t size() const
+		{
+			return _v.size();
+		}
+		bool empty() const
+		{
+			return _v.empty();
+		}
+
+		void insert(size_t index, const T& t)
+		{
+			_v.insert(_v.begin() + index, t);
+			changed(VectorDiff::Op::Insert, index, 1);
+		}
+		template<typename It>
+		void insert(size_t index, It first, It last)
+		{
+			size_t prev = _v.size();
+			_v.insert(_v.begin() + index, first, last);
+			changed(VectorDiff::Op::Insert, index, _v.size() - prev);
+		}
+		void push_back(const T& t)
+		{
+			insert(_v.size(), t);
+		}
+		void erase(size_t index, size_t count = 1)
+		{
+			_v.erase(_v.begin() + index, _v.begin() + index + count);
+			changed(VectorDiff::Op::Erase, index, count);
+		}
+		void pop_back()
+		{
+			erase(_v.size() - 1);
+		}
+		void clear()
+		{
+			erase(0, _v.size());
+		}
+		void update(size_t index, const T& t)
+		{
+			_v[index] = t;
+			changed(VectorDiff::Op::Update, index, 1);
+		}
+		void update(size_t index, T&& t)
+		{
+			_v[index] = std::move(t);
+			changed(VectorDiff::Op::Update, index, 1);
+		}
+		// moves count elements starting at from, so that the first one ends up at index to
+		// (to being an index in the vector once the moved elements are removed)
+		void move(size_t from, size_t to, size_t count = 1)
+		{
+			if (from == to) return;
+			std::vector<T> moved(std::make_move_iterator(_v.begin() + from), std::make_move_iterator(_v.begin() + from + count));
+			_v.erase(_v.begin() + from, _v.begin() + from + count);
+			_v.insert(_v.begin() + to, std::make_move_iterator(moved.begin()), std::make_move_iterator(moved.end()));
+			changed(VectorDiff::Op::Move, from, count, to);
+		}
+
+		// sends the pending diff, if any
+		void flush()
+		{
+			if (_pending.empty()) return;
+			VectorDiff diff;
+			std::swap(diff, _pending);
+			_e.notify(diff);
+		}
+
+		// RAII way to merge all the changes made in a scope into one notification
+		class ScopedBatch
+		{
+			ValueVector& _v;
+		public:
+			ScopedBatch(ValueVector& v) : _v(v)
+			{
+				_v._batch++;
+			}
+			~ScopedBatch()
+			{
+				if (--_v._batch == 0) _v.flush();
+			}
+		};
+
+		Event<const VectorDiff&>& getEvent()
+		{
+			return _e;
+		}
+		typename Event<const VectorDiff&>::ScopedCallbackID* addListener(const Callback& c, bool first = false PICOEVENTS_LOCATION_PARAM)
+		{
+			return addCallback(_e, c, first PICOEVENTS_LOCATION_ARG);
+		}
+	};
+
+
+	template<typename K>
+	struct MapDiff
+	{
+		enum class Op { Insert, Erase, Update };
+		struct Change
+		{
+			Op op;
+			K key;
+		};
+		std::vector<Change> changes;
+
+		bool empty() const
+		{
+			return changes.empty();
+		}
+	};
+
+
+	// a std::map<K, V> notifying MapDiff<K>
+	// added listeners are removed when the container is deleted
+	template<typename K, typename V, typename Compare = std::less<K>>
+	class ValueMap : public ScopedCallbacksHolder
+	{
+		using Diff = MapDiff<K>;
+		using Op = typename Diff::Op;
+
+		std::map<K, V, Compare> _m;
+		Event<const Diff&> _e;
+		// pending changes of the current batch, one per key
+		std::map<K, Op, Compare> _pending;
+		int _batch = 0;
+
+		void changed(const K& key, Op op)
+		{
+			auto it = _pending.find(key);
+			if (it == _pending.end())
+			{
+				_pending.emplace(key, op);
+			}
+			else
+			{
+				// combine with the previous change of the same key
+				Op prev = it->second;
+				if (prev == Op::Insert && op == Op::Erase) _pending.erase(it);
+				else if (prev == Op::Erase && op == Op::Insert) it->second = Op::Update;
+				else if (prev != Op::Insert) it->second = op;
+			}
+			if (_batch == 0) flush();
+		}
+	public:
+		using Callback = typename Event<const Diff&>::Callback;
+
+		ValueMap() = default;
+		ValueMap(std::map<K, V, Compare> m) : _m(std::move(m)) {}
+		virtual ~ValueMap()
+		{
+			removeAllCallbacks(); // remove callbacks before deleting _e
+		}
+
+		const std::map<K, V, Compare>& get() const
+		{
+			return _m;
+		}
+		size_t size() const
+		{
+			return _m.size();
+		}
+		bool contains(const K& key) const
+		{
+			return _m.find(key) != _m.end();
+		}
+		// returns nullptr if key is not present
+		const V* find(const K& key) const
+		{
+			auto it = _m.find(key);
+			return it == _m.end() ? nullptr : &it->second;
+		}
+
+		// inserts or updates key
+		void set(const K& key, V v)
+		{
+			auto it = _m.find(key);
+			if (it == _m.end())
+			{
+				_m.emplace(key, std::move(v));
+				changed(key, Op::Insert);
+			}
+			else
+			{
+				it->second = std::move(v);
+				changed(key, Op::Update);
+			}
+		}
+		bool erase(const K& key)
+		{
+			// key can be the one of the erased element (see clear()), the
+			// extracted node keeps it alive until the change is recorded
+			auto node = _m.extract(key);
+			if (node.empty()) return false;
+			changed(node.key(), Op::Erase);
+			return true;
+		}
+		void clear()
+		{
+			ScopedBatch batch(*this);
+			while (!_m.empty()) erase(_m.begin()->first);
+		}
+
+		// sends the pending diff, if any
+		void flush()
+		{
+			if (_pending.empty()) return;
+			Diff diff;
+			diff.changes.reserve(_pending.size());
+			for (auto& p : _pending) diff.changes.push_back({ p.second, p.first });
+			_pending.clear();
+			_e.notify(diff);
+		}
+
+		// RAII way to merge all the changes made in a scope into one notification
+		class ScopedBatch
+		{
+			ValueMap& _m;
+		public:
+			ScopedBatch(ValueMap& m) : _m(m)
+			{
+				_m._batch++;
+			}
+			~ScopedBatch()
+			{
+				if (--_m._batch == 0) _m.flush();
+			}
+		};
+
+		Event<const Diff&>& getEvent()
+		{
+			return _e;
+		}
+		typename Event<const Diff&>::ScopedCallbackID* addListener(const Callback& c, bool first = false PICOEVENTS_LOCATION_PARAM)
+		{
+			return addCallback(_e, c, first PICOEVENTS_LOCATION_ARG);
+		}
+	};
+}
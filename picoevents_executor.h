@@ -0,0 +1,349 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "picoevents_async.h"
+#include "picoevents_queue.h"
+
+/*
+ A thread pool to run notifications (and anything else) on:
+
+ picoevents::Executor executor;                 // one worker per core
+ auto done = valueChangedEvent.notifyAsync(executor, 42);
+ executor.postMain([&] { label.refresh(); });    // for the thread calling runMain()
+ ...
+ executor.runMain();                            // from the main / UI loop
+
+ Each worker owns a work-stealing deque (Chase-Lev): the tasks it posts go to
+ its own deque, the idle workers steal from the other end. The tasks posted
+ from the other threads go through a lock-free injection queue, drained by the
+ first worker that has nothing else to do.
+ The idle workers spin, yield or sleep (Idle::Park, on a condition variable)
+ until something is posted.
+ The destructor waits for the posted tasks to be done, except the ones posted
+ with postMain() that were never run.
+*/
+
+namespace picoevents
+{
+	namespace detail
+	{
+		struct Job
+		{
+			std::atomic<Job*> next { nullptr };
+			std::function<void()> task;
+		};
+
+		using JobQueue = MpscQueue<Job>;
+
+		//
+		// Chase-Lev work-stealing deque (as in Le, Pop, Cohen, Zappa Nardelli 2013):
+		// the owner pushes and takes at the bottom, the others steal from the top.
+		// The arrays replaced when growing are kept until the deque is deleted,
+		// a thief may still be reading them
+		//
+		class WorkDeque
+		{
+		public:
+			WorkDeque()
+			{
+				_arrays.emplace_back(new Array(64));
+				_array.store(_arrays.back().get(), std::memory_order_relaxed);
+			}
+			WorkDeque(const WorkDeque&) = delete;
+			WorkDeque& operator=(const WorkDeque&) = delete;
+			~WorkDeque()
+			{
+				while (Job* j = take()) delete j;
+			}
+
+			// owner only
+			void push(Job* j)
+			{
+				int64_t b = _bottom.load(std::memory_order_relaxed);
+				int64_t t = _top.load(std::memory_order_acquire);
+				Array* a = _array.load(std::memory_order_relaxed);
+				if (b - t > (int64_t)a->mask)
+				{
+					a = grow(a, t, b);
+				}
+				a->put(b, j);
+				_bottom.store(b + 1, std::memory_order_release);
+			}
+			// owner only
+			Job* take()
+			{
+				int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+				Array* a = _array.load(std::memory_order_relaxed);
+				_bottom.store(b, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				int64_t t = _top.load(std::memory_order_relaxed);
+				if (t > b)
+				{
+					_bottom.store(b + 1, std::memory_order_relaxed);
+					return nullptr;
+				}
+				Job* j = a->get(b);
+				if (t == b)
+				{
+					// last one, race with the thieves
+					if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) j = nullptr;
+					_bottom.store(b + 1, std::memory_order_relaxed);
+				}
+				return j;
+			}
+			// any thread, nullptr if empty or lost a race
+			Job* steal()
+			{
+				int64_t t = _top.load(std::memory_order_acquire);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				int64_t b = _bottom.load(std::memory_order_acquire);
+				if (t >= b) return nullptr;
+				Job* j = _array.load(std::memory_order_acquire)->get(t);
+				if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+				return j;
+			}
+			bool empty() const
+			{
+				return _bottom.load(std::memory_order_acquire) <= _top.load(std::memory_order_acquire);
+			}
+
+		private:
+			struct Array
+			{
+				size_t mask;
+				std::unique_ptr<std::atomic<Job*>[]> jobs;
+				Array(size_t capacity) : mask(capacity - 1), jobs(new std::atomic<Job*>[capacity]) {}
+				Job* get(int64_t i) const
+				{
+					return jobs[i & mask].load(std::memory_order_relaxed);
+				}
+				void put(int64_t i, Job* j)
+				{
+					jobs[i & mask].store(j, std::memory_order_relaxed);
+				}
+			};
+			Array* grow(Array* a, int64_t t, int64_t b)
+			{
+				Array* bigger = new Array((a->mask + 1) * 2);
+				for (int64_t i = t; i < b; i++) bigger->put(i, a->get(i));
+				_arrays.emplace_back(bigger);
+				_array.store(bigger, std::memory_order_release);
+				return bigger;
+			}
+
+			alignas(64) std::atomic<int64_t> _top { 0 };
+			alignas(64) std::atomic<int64_t> _bottom { 0 };
+			std::atomic<Array*> _array;
+			std::vector<std::unique_ptr<Array>> _arrays;
+		};
+	}
+
+
+	class Executor
+	{
+	public:
+		using Task = std::function<void()>;
+		// what the workers do when there is nothing to run
+		enum class Idle { Spin, Yield, Park };
+
+		// workers = 0 starts one per core
+		explicit Executor(size_t workers = 0, Idle idle = Idle::Park) : _idle(idle)
+		{
+			if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+			for (size_t i = 0; i < workers; i++) _workers.emplace_back(new Worker());
+			for (size_t i = 0; i < workers; i++)
+			{
+				_workers[i]->thread = std::thread([this, i] { run(i); });
+			}
+		}
+		Executor(const Executor&) = delete;
+		Executor& operator=(const Executor&) = delete;
+		~Executor()
+		{
+			_stop.store(true);
+			wake(true);
+			for (auto& w : _workers) w->thread.join();
+		}
+
+		size_t workerCount() const
+		{
+			return _workers.size();
+		}
+
+		// runs task on one of the workers, from any thread
+		void post(Task task)
+		{
+			detail::Job* j = new detail::Job();
+			j->task = std::move(task);
+			Worker* w = current();
+			if (w && w->owner == this) w->deque.push(j);
+			else _injected.push(j);
+			wake(false);
+		}
+
+		// runs task on the thread calling runMain(), from any thread
+		void postMain(Task task)
+		{
+			detail::Job* j = new detail::Job();
+			j->task = std::move(task);
+			_main.push(j);
+		}
+		// runs (at most max of) the tasks given to postMain(), returns how many were run.
+		// Only one thread should call it
+		size_t runMain(size_t max = SIZE_MAX)
+		{
+			size_t n = 0;
+			while (n < max)
+			{
+				detail::Job* j = _main.pop();
+				if (!j) break;
+				j->task();
+				delete j;
+				n++;
+			}
+			return n;
+		}
+
+	private:
+		struct Worker
+		{
+			detail::WorkDeque deque;
+			Executor* owner = nullptr;
+			std::thread thread;
+		};
+		static Worker*& current()
+		{
+			thread_local Worker* w = nullptr;
+			return w;
+		}
+
+		detail::Job* find(size_t self)
+		{
+			Worker& w = *_workers[self];
+			if (detail::Job* j = w.deque.take()) return j;
+			// one worker at a time drains the injection queue
+			if (!_injected.empty() && !_draining.exchange(true, std::memory_order_acquire))
+			{
+				detail::Job* j = _injected.pop();
+				// take a few more so that the others can steal them
+				int moved = 0;
+				for (; j && moved < 16; moved++)
+				{
+					detail::Job* next = _injected.pop();
+					if (!next) break;
+					w.deque.push(next);
+				}
+				_draining.store(false, std::memory_order_release);
+				if (moved) wake(false);
+				if (j) return j;
+			}
+			for (size_t i = 1; i < _workers.size(); i++)
+			{
+				if (detail::Job* j = _workers[(self + i) % _workers.size()]->deque.steal()) return j;
+			}
+			return nullptr;
+		}
+
+		bool hasWork() const
+		{
+			if (!_injected.empty()) return true;
+			for (auto& w : _workers)
+			{
+				if (!w->deque.empty()) return true;
+			}
+			return false;
+		}
+
+		void run(size_t self)
+		{
+			Worker& w = *_workers[self];
+			w.owner = this;
+			current() = &w;
+			for (;;)
+			{
+				uint64_t epoch = _epoch.load();
+				if (detail::Job* j = find(self))
+				{
+					j->task();
+					delete j;
+					continue;
+				}
+				if (_stop.load() && !hasWork()) break;
+				switch (_idle)
+				{
+				case Idle::Spin:
+					break;
+				case Idle::Yield:
+					std::this_thread::yield();
+					break;
+				case Idle::Park:
+				{
+					std::unique_lock<std::mutex> lock(_mutex);
+					_sleepers++;
+					// a post() made since epoch was read wakes us up or is seen here
+					_cv.wait(lock, [&] { return _epoch.load() != epoch || _stop.load(); });
+					_sleepers--;
+					break;
+				}
+				}
+			}
+			current() = nullptr;
+		}
+
+		void wake(bool all)
+		{
+			_epoch.fetch_add(1);
+			if (_idle != Idle::Park || _sleepers.load() == 0) return;
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (all) _cv.notify_all();
+			else _cv.notify_one();
+		}
+
+		std::vector<std::unique_ptr<Worker>> _workers;
+		detail::JobQueue _injected;
+		std::atomic<bool> _draining { false };
+		detail::JobQueue _main;
+		Idle _idle;
+		std::atomic<bool> _stop { false };
+		std::atomic<uint64_t> _epoch { 0 };
+		std::atomic<int> _sleepers { 0 };
+		std::mutex _mutex;
+		std::condition_variable _cv;
+	};
+}
@@ -0,0 +1,344 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "picoevents.h"
+
+/*
+ An Event that never allocates: room for N callbacks inside the object
+
+ picoevents::InlineEvent<4, int> levelChanged;
+ levelChanged.add([this](int level) { meter.set(level); });
+ levelChanged.notify(3);
+
+ The callables are stored inline too, they must fit in
+ PICOEVENTS_INLINE_CALLABLE_SIZE bytes, which is checked at compile time.
+ By default it is 4 pointers or a std::function, whichever is bigger
+ (32 bytes with libstdc++, 48 with libc++, 64 with MSVC), so a std::function
+ is always accepted, but it may allocate by itself. Define it for the whole
+ project to store bigger lambdas, each of the N places takes that much.
+ Same API and rules as Event (ids, muting, ScopedDisable, ScopedCallbackID,
+ callbacks added or removed while notifying), but InlineEvent can't be copied.
+ When the N places are taken add() returns an invalid id and calls the
+ overflow handler, if one was set with InlineEventBase::setOverflowHandler().
+*/
+
+#if !defined(PICOEVENTS_INLINE_CALLABLE_SIZE)
+#define PICOEVENTS_INLINE_CALLABLE_SIZE std::max(4 * sizeof(void*), sizeof(std::function<void()>))
+#endif
+
+namespace picoevents
+{
+	class InlineEventBase
+	{
+	public:
+		// called with the capacity of the event by an add() that doesn't fit
+		using OverflowHandler = void (*)(size_t capacity);
+		static void setOverflowHandler(OverflowHandler handler)
+		{
+			overflowHandler() = handler;
+		}
+
+	protected:
+		static OverflowHandler& overflowHandler()
+		{
+			static OverflowHandler handler = nullptr;
+			return handler;
+		}
+	};
+
+	template<size_t N, typename ...T>
+	class InlineEvent : public InlineEventBase
+	{
+		static_assert(N > 0 && N < SubscriptionID::Invalid, "InlineEvent needs room for at least one callback");
+	public:
+		using Callback = std::function<void(T...)>;
+		using CallbackID = SubscriptionID;
+		static constexpr size_t Capacity = N;
+		static constexpr size_t CallableSize = PICOEVENTS_INLINE_CALLABLE_SIZE;
+
+		InlineEvent()
+		{
+			for (size_t i = 0; i < N; i++) _free[i] = (uint32_t)(N - 1 - i);
+		}
+		InlineEvent(const InlineEvent&) = delete;
+		InlineEvent& operator=(const InlineEvent&) = delete;
+		~InlineEvent()
+		{
+			for (size_t i = 0; i < _count; i++) release(_slots[_order[i]]);
+		}
+
+		void setEnabled(bool b)
+		{
+			_enabled = b;
+		}
+		bool isEnabled() const
+		{
+			return _enabled;
+		}
+
+		CallbackID empty_callback()
+		{
+			return CallbackID();
+		}
+
+		template<typename F>
+		CallbackID add(F&& f, bool first = false)
+		{
+			using C = typename std::decay<F>::type;
+			static_assert(sizeof(C) <= CallableSize,
+				"callable too big for InlineEvent: capture less (e.g. a single pointer) or define PICOEVENTS_INLINE_CALLABLE_SIZE bigger for the whole project");
+			static_assert(alignof(C) <= alignof(std::max_align_t), "callable over-aligned for InlineEvent");
+			if (_freeCount == 0)
+			{
+				if (overflowHandler()) overflowHandler()(N);
+				return CallbackID();
+			}
+			uint32_t slot = _free[--_freeCount];
+			Slot& s = _slots[slot];
+			new (s.storage) C(std::forward<F>(f));
+			s.invoke = &invokeCallable<C>;
+			s.destroy = &destroyCallable<C>;
+			s.muted = false;
+			_order[_count++] = slot;
+			if (first)
+			{
+				// positions can't change while notifying, it is moved
+				// to the front once the notification is over
+				if (_depth > 0) s.pendingFront = true;
+				else moveToFront(_count - 1);
+			}
+			return CallbackID { slot, s.generation };
+		}
+		void remove(CallbackID& id)
+		{
+			if (isValid(id))
+			{
+				Slot& s = _slots[id.slot];
+				s.generation++;
+				s.removed = true;
+				s.pendingFront = false;
+				// the callback may be the one being called,
+				// it is deleted once the notification is over
+				if (_depth > 0) _pendingDelete = true;
+				else compact();
+			}
+			id = CallbackID();
+		}
+		bool isValid(CallbackID id) const
+		{
+			return id.slot < N && _slots[id.slot].invoke && !_slots[id.slot].removed
+				&& _slots[id.slot].generation == id.generation;
+		}
+
+		// a muted callback keeps its place but is skipped by notify()
+		void setMuted(CallbackID id, bool muted)
+		{
+			if (isValid(id)) _slots[id.slot].muted = muted;
+		}
+		bool isMuted(CallbackID id) const
+		{
+			return isValid(id) && _slots[id.slot].muted;
+		}
+
+		// number of callbacks (muted ones included)
+		size_t size() const
+		{
+			size_t n = 0;
+			for (size_t i = 0; i < _count; i++) n += !_slots[_order[i]].removed;
+			return n;
+		}
+
+		// overloading () so you can do event(a, b, c); instead of event.notify(a, b, c);
+		void operator()(T... t)
+		{
+			notify(t...);
+		}
+
+		void notify(T... t) const
+		{
+			if (!_enabled) return;
+			_depth++;
+			// the callbacks added meanwhile are after end
+			size_t end = _count;
+			for (size_t i = 0; i < end; i++)
+			{
+				Slot& s = _slots[_order[i]];
+				if (!s.removed && !s.muted) s.invoke(s.storage, t...);
+			}
+			if (--_depth == 0 && _pendingDelete) compact();
+			if (_depth == 0) applyPendingFront();
+		}
+
+		// RAII way to temporary mute a single callback
+		class ScopedMute
+		{
+			InlineEvent& _e;
+			CallbackID _id;
+			bool _prev;
+		public:
+			ScopedMute(InlineEvent& e, CallbackID id) : _e(e), _id(id), _prev(_e.isMuted(id))
+			{
+				_e.setMuted(_id, true);
+			}
+			~ScopedMute()
+			{
+				_e.setMuted(_id, _prev);
+			}
+		};
+
+		// RAII way to temporary disable an event
+		class ScopedDisable
+		{
+			InlineEvent& _e;
+			bool _prev;
+		public:
+			ScopedDisable(InlineEvent& e) : _e(e), _prev(_e.isEnabled())
+			{
+				_e.setEnabled(false);
+			}
+			~ScopedDisable()
+			{
+				_e.setEnabled(_prev);
+			}
+		};
+
+		class ScopedCallbackID : public ScopedCallbackIDBase
+		{
+			InlineEvent& _event;
+			CallbackID _cb;
+		public:
+			template<typename F>
+			ScopedCallbackID(InlineEvent& event, F&& f, bool first = false PICOEVENTS_LOCATION_PARAM) : _event(event)
+			{
+#if defined(PICOEVENTS_REGISTRY)
+				(void)location;
+#endif
+				_cb = _event.add(std::forward<F>(f), first);
+			}
+			ScopedCallbackID(ScopedCallbackID&& other) : _event(other._event), _cb(other._cb)
+			{
+				other._cb = CallbackID();
+			}
+			virtual ~ScopedCallbackID()
+			{
+				_event.remove(_cb);
+			}
+			bool isValid() const
+			{
+				return _event.isValid(_cb);
+			}
+			InlineEvent& getEvent()
+			{
+				return _event;
+			}
+		};
+
+	private:
+		struct Slot
+		{
+			alignas(std::max_align_t) unsigned char storage[CallableSize];
+			void (*invoke)(void*, T...) = nullptr;
+			void (*destroy)(void*) = nullptr;
+			uint32_t generation = 0;
+			bool muted = false;
+			bool removed = false;
+			bool pendingFront = false;
+		};
+
+		template<typename C>
+		static void invokeCallable(void* context, T... t)
+		{
+			(*static_cast<C*>(context))(std::forward<T>(t)...);
+		}
+		template<typename C>
+		static void destroyCallable(void* context)
+		{
+			static_cast<C*>(context)->~C();
+		}
+
+		static void release(Slot& s)
+		{
+			if (s.invoke) s.destroy(s.storage);
+			s.invoke = nullptr;
+			s.removed = false;
+		}
+		void moveToFront(size_t pos) const
+		{
+			uint32_t slot = _order[pos];
+			std::move_backward(_order, _order + pos, _order + pos + 1);
+			_order[0] = slot;
+		}
+		// deletes the removed callbacks
+		void compact() const
+		{
+			size_t n = 0;
+			for (size_t i = 0; i < _count; i++)
+			{
+				uint32_t slot = _order[i];
+				if (_slots[slot].removed)
+				{
+					release(_slots[slot]);
+					_free[_freeCount++] = slot;
+				}
+				else _order[n++] = slot;
+			}
+			_count = n;
+			_pendingDelete = false;
+		}
+		void applyPendingFront() const
+		{
+			for (size_t i = 0; i < _count; i++)
+			{
+				if (_slots[_order[i]].pendingFront)
+				{
+					_slots[_order[i]].pendingFront = false;
+					moveToFront(i);
+				}
+			}
+		}
+
+		// mutable as a notification drops the callbacks removed while it was running
+		mutable Slot _slots[N];
+		mutable uint32_t _order[N];			// slots in notification order
+		mutable size_t _count = 0;
+		mutable uint32_t _free[N];
+		mutable size_t _freeCount = N;
+		mutable int _depth = 0;
+		mutable bool _pendingDelete = false;
+		bool _enabled = true;
+	};
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/*
+ Passing large immutable payloads through events by handle
+
+ picoevents::InternArena<std::string> paths;
+ picoevents::Event<picoevents::InternArena<std::string>::Handle> opened;
+ opened.add(paths.resolving([](const std::string& path) { ... }));
+
+ auto notifier = opened.makeNotifier(paths.intern(longPath));  // copies 8 bytes
+ ...
+ notifier.trigger();
+ paths.clear();                 // once per frame, frees everything at once
+
+ The payloads are stored once in the arena and never modified. A Handle is
+ 64 bits: the index of the payload (24 bits) and the generation of the arena
+ (40 bits), so the handles still queued when the arena is cleared resolve to
+ nullptr (and the callbacks wrapped by resolving() are skipped) instead of to
+ another payload. The generation only wraps after 2^40 clear()s.
+ intern() returns the same handle for equal payloads (T must then be hashable
+ and equality comparable, only intern() requires it), store() doesn't look for
+ them. The index of intern() holds arena positions, not copies of the payloads.
+ Not thread-safe: the arena must be used (and cleared) by one thread at a time.
+*/
+
+namespace picoevents
+{
+	template<typename T>
+	class InternArena
+	{
+		static constexpr unsigned IndexBits = 24;
+		static constexpr uint64_t IndexMask = (uint64_t(1) << IndexBits) - 1;
+		static constexpr uint64_t GenerationLimit = uint64_t(1) << (64 - IndexBits);
+		static constexpr size_t ChunkSize = 256;
+
+	public:
+		struct Handle
+		{
+			uint64_t value = 0;
+			bool operator==(Handle other) const
+			{
+				return value == other.value;
+			}
+			bool operator!=(Handle other) const
+			{
+				return value != other.value;
+			}
+		};
+
+		InternArena() = default;
+		InternArena(const InternArena&) = delete;
+		InternArena& operator=(const InternArena&) = delete;
+		~InternArena()
+		{
+			destroyAll();
+		}
+
+		// the handle of an equal payload if there is one, else stores a copy of t
+		Handle intern(const T& t)
+		{
+			size_t hash = std::hash<T>()(t);
+			if ((_indexUsed + 1) * 4 > _index.size() * 3) rehash(_index.empty() ? 16 : _index.size() * 2);
+			size_t mask = _index.size() - 1;
+			size_t b = mix(hash) & mask;
+			for (; _index[b].position != NoPayload; b = (b + 1) & mask)
+			{
+				if (_index[b].hash == hash && *slot(_index[b].position) == t) return makeHandle(_index[b].position);
+			}
+			Handle h = store(t);
+			if (h != Handle())
+			{
+				_index[b] = IndexEntry { hash, uint32_t(h.value & IndexMask) };
+				_indexUsed++;
+			}
+			return h;
+		}
+		// an invalid Handle (never resolved) once the arena holds 2^24 payloads
+		Handle store(T t)
+		{
+			if (_size > IndexMask) return Handle();
+			uint32_t i = (uint32_t)_size;
+			if (_size == _chunks.size() * ChunkSize) _chunks.emplace_back(new Chunk());
+			new (slot(i)) T(std::move(t));
+			_size++;
+			return makeHandle(i);
+		}
+
+		// nullptr if h was made before the last clear()
+		const T* resolve(Handle h) const
+		{
+			uint32_t i = uint32_t(h.value & IndexMask);
+			if ((h.value >> IndexBits) != _generation || i >= _size) return nullptr;
+			return slot(i);
+		}
+
+		// deletes all the payloads, the memory is kept for the next ones
+		void clear()
+		{
+			destroyAll();
+			std::fill(_index.begin(), _index.end(), IndexEntry());
+			_indexUsed = 0;
+			// generation 0 is skipped so that a default Handle never resolves
+			if (++_generation == GenerationLimit) _generation = 1;
+		}
+		size_t size() const
+		{
+			return _size;
+		}
+
+		// wraps f(const T&) into a callback taking a Handle, skipped if it is stale
+		template<typename F>
+		auto resolving(F f) const
+		{
+			return [this, f](Handle h) mutable
+			{
+				if (const T* t = resolve(h)) f(*t);
+			};
+		}
+
+	private:
+		struct Chunk
+		{
+			alignas(T) unsigned char data[ChunkSize * sizeof(T)];
+		};
+
+		T* slot(uint32_t i) const
+		{
+			return reinterpret_cast<T*>(_chunks[i / ChunkSize]->data) + (i % ChunkSize);
+		}
+		Handle makeHandle(uint32_t i) const
+		{
+			return Handle { (_generation << IndexBits) | i };
+		}
+		// the index of intern(): an open addressing table of arena positions,
+		// with their hash so that growing it doesn't hash the payloads again
+		static constexpr uint32_t NoPayload = ~uint32_t(0);
+		struct IndexEntry
+		{
+			size_t hash = 0;
+			uint32_t position = NoPayload;
+		};
+		static size_t mix(size_t hash)
+		{
+			uint64_t h = uint64_t(hash) * 0x9e3779b97f4a7c15ull;
+			return size_t(h ^ (h >> 32));
+		}
+		void rehash(size_t capacity)
+		{
+			std::vector<IndexEntry> index(capacity);
+			for (const IndexEntry& e : _index)
+			{
+				if (e.position == NoPayload) continue;
+				size_t b = mix(e.hash) & (capacity - 1);
+				while (index[b].position != NoPayload) b = (b + 1) & (capacity - 1);
+				index[b] = e;
+			}
+			_index.swap(index);
+		}
+		void destroyAll()
+		{
+			for (uint32_t i = 0; i < _size; i++) slot(i)->~T();
+			_size = 0;
+		}
+
+		std::vector<std::unique_ptr<Chunk>> _chunks;
+		size_t _size = 0;
+		uint64_t _generation = 1;
+		std::vector<IndexEntry> _index;		// power of 2 size, empty until the first intern()
+		size_t _indexUsed = 0;
+	};
+}
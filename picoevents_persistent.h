@@ -0,0 +1,198 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+/*
+ An immutable vector with structural sharing, meant to be stored in a
+ picoevents::Value with history enabled:
+
+ picoevents::Value<picoevents::PersistentVector<int>> rows({ 1, 2, 3 });
+ rows.enableHistory();
+ rows.set(rows.get().set(1, 42));    // O(log n), shares all untouched nodes
+ rows.set(rows.get().push_back(4));
+ picoevents::History::global().undo();
+
+ Copying a PersistentVector is O(1), so recording the before / after values
+ of an edit costs nothing more than the edit itself.
+ The elements are stored in a 32-way tree, operator[], set(), push_back()
+ and pop_back() are O(log32 n) and return a new vector when modifying.
+*/
+
+namespace picoevents
+{
+	template<typename T>
+	class PersistentVector
+	{
+		static constexpr unsigned Bits = 5;
+		static constexpr size_t Width = size_t(1) << Bits;
+		static constexpr size_t Mask = Width - 1;
+
+		// leaves use _values, inner nodes use _children
+		struct Node
+		{
+			std::vector<std::shared_ptr<const Node>> children;
+			std::vector<T> values;
+		};
+		using NodePtr = std::shared_ptr<const Node>;
+
+		NodePtr _root;
+		size_t _size = 0;
+		unsigned _shift = 0;
+
+		PersistentVector(NodePtr root, size_t size, unsigned shift) : _root(std::move(root)), _size(size), _shift(shift) {}
+
+		static NodePtr newPath(unsigned level, const T& t)
+		{
+			auto n = std::make_shared<Node>();
+			if (level == 0) n->values.push_back(t);
+			else n->children.push_back(newPath(level - Bits, t));
+			return n;
+		}
+		static NodePtr setIn(const NodePtr& node, unsigned level, size_t i, const T& t)
+		{
+			auto n = std::make_shared<Node>(*node);
+			if (level == 0) n->values[i & Mask] = t;
+			else
+			{
+				size_t sub = (i >> level) & Mask;
+				n->children[sub] = setIn(node->children[sub], level - Bits, i, t);
+			}
+			return n;
+		}
+		static NodePtr pushIn(const NodePtr& node, unsigned level, size_t i, const T& t)
+		{
+			auto n = std::make_shared<Node>(*node);
+			if (level == 0) n->values.push_back(t);
+			else
+			{
+				size_t sub = (i >> level) & Mask;
+				if (sub < n->children.size()) n->children[sub] = pushIn(node->children[sub], level - Bits, i, t);
+				else n->children.push_back(newPath(level - Bits, t));
+			}
+			return n;
+		}
+		// returns nullptr when the node becomes empty
+		static NodePtr popIn(const NodePtr& node, unsigned level, size_t i)
+		{
+			auto n = std::make_shared<Node>(*node);
+			if (level == 0) n->values.pop_back();
+			else
+			{
+				size_t sub = (i >> level) & Mask;
+				NodePtr child = popIn(node->children[sub], level - Bits, i);
+				if (child) n->children[sub] = std::move(child);
+				else n->children.pop_back();
+			}
+			if (n->values.empty() && n->children.empty()) return nullptr;
+			return n;
+		}
+
+	public:
+		PersistentVector() = default;
+		PersistentVector(std::initializer_list<T> l)
+		{
+			for (const T& t : l) *this = push_back(t);
+		}
+		template<typename It>
+		PersistentVector(It first, It last)
+		{
+			for (; first != last; first++) *this = push_back(*first);
+		}
+
+		size_t size() const
+		{
+			return _size;
+		}
+		bool empty() const
+		{
+			return _size == 0;
+		}
+
+		const T& operator[](size_t i) const
+		{
+			const Node* n = _root.get();
+			for (unsigned level = _shift; level > 0; level -= Bits)
+			{
+				n = n->children[(i >> level) & Mask].get();
+			}
+			return n->values[i & Mask];
+		}
+		const T& back() const
+		{
+			return (*this)[_size - 1];
+		}
+
+		PersistentVector set(size_t i, const T& t) const
+		{
+			return PersistentVector(setIn(_root, _shift, i, t), _size, _shift);
+		}
+		PersistentVector push_back(const T& t) const
+		{
+			if (!_root) return PersistentVector(newPath(0, t), 1, 0);
+			if (_size == (size_t(1) << (_shift + Bits)))
+			{
+				// root is full, grow the tree by one level
+				auto n = std::make_shared<Node>();
+				n->children.push_back(_root);
+				n->children.push_back(newPath(_shift, t));
+				return PersistentVector(std::move(n), _size + 1, _shift + Bits);
+			}
+			return PersistentVector(pushIn(_root, _shift, _size, t), _size + 1, _shift);
+		}
+		PersistentVector pop_back() const
+		{
+			if (_size <= 1) return PersistentVector();
+			NodePtr root = popIn(_root, _shift, _size - 1);
+			unsigned shift = _shift;
+			while (shift > 0 && root->children.size() == 1)
+			{
+				root = root->children[0];
+				shift -= Bits;
+			}
+			return PersistentVector(std::move(root), _size - 1, shift);
+		}
+
+		// true when both vectors share the same tree (cheap identity test)
+		bool sharesWith(const PersistentVector& other) const
+		{
+			return _root == other._root && _size == other._size;
+		}
+
+		std::vector<T> toVector() const
+		{
+			std::vector<T> res;
+			res.reserve(_size);
+			for (size_t i = 0; i < _size; i++) res.push_back((*this)[i]);
+			return res;
+		}
+	};
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+
+#include <atomic>
+#include <cstddef>
+
+namespace picoevents
+{
+	namespace detail
+	{
+		//
+		// unbounded multi-producer single-consumer queue (D. Vyukov),
+		// pop() can return nullptr while a push() is half done.
+		// Intrusive: Node needs a std::atomic<Node*> next member, the queue
+		// deletes the nodes left when it is deleted
+		//
+		template<typename Node>
+		class MpscQueue
+		{
+		public:
+			MpscQueue() : _head(&_stub), _tail(&_stub) {}
+			MpscQueue(const MpscQueue&) = delete;
+			MpscQueue& operator=(const MpscQueue&) = delete;
+			~MpscQueue()
+			{
+				while (Node* n = pop()) delete n;
+			}
+
+			void push(Node* n)
+			{
+				n->next.store(nullptr, std::memory_order_relaxed);
+				Node* prev = _head.exchange(n, std::memory_order_acq_rel);
+				prev->next.store(n, std::memory_order_release);
+				if (n != &_stub) _size.fetch_add(1, std::memory_order_release);
+			}
+			// from any thread
+			bool empty() const
+			{
+				return _size.load(std::memory_order_acquire) == 0;
+			}
+			// single consumer
+			Node* pop()
+			{
+				Node* tail = _tail;
+				Node* next = tail->next.load(std::memory_order_acquire);
+				if (tail == &_stub)
+				{
+					if (!next) return nullptr;
+					_tail = next;
+					tail = next;
+					next = next->next.load(std::memory_order_acquire);
+				}
+				if (next)
+				{
+					_tail = next;
+					return popped(tail);
+				}
+				if (tail != _head.load(std::memory_order_acquire)) return nullptr;
+				push(&_stub);
+				next = tail->next.load(std::memory_order_acquire);
+				if (next)
+				{
+					_tail = next;
+					return popped(tail);
+				}
+				return nullptr;
+			}
+
+		private:
+			Node* popped(Node* n)
+			{
+				_size.fetch_sub(1, std::memory_order_relaxed);
+				return n;
+			}
+
+			std::atomic<Node*> _head;
+			Node* _tail;
+			Node _stub;
+			std::atomic<size_t> _size { 0 };
+		};
+	}
+}
@@ -0,0 +1,301 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include "picoevents.h"
+#include "picoevents_inline.h"
+#include "picoevents_queue.h"
+
+/*
+ An event notified from a real-time thread (an audio callback...) and
+ subscribed to from the other threads
+
+ picoevents::RealtimeEvent<16, const float*, size_t> block;
+ auto id = block.add([&](const float* samples, size_t n) { meter.process(samples, n); });  // UI thread
+ block.notify(samples, n);                                                                // audio thread
+ block.remove(id);                                                                        // UI thread
+
+ Guarantees of notify(), made on the real-time thread only:
+ - no allocation, no deallocation, no lock, no system call,
+ - bounded time: it applies the changes made since the previous notify(), then
+   calls at most N callbacks (and whatever they do is up to them).
+ add(), remove() and setMuted() are for the other threads (any number of them,
+ but not the real-time one): they allocate the callable and send the change to
+ the real-time thread through a lock-free queue, it takes effect at the next
+ notify(). The callables removed by notify() are sent back the same way and
+ deleted by the next add() / remove() / setMuted() / collect() on another thread.
+ The other threads serialize their calls with a mutex the real-time thread never takes.
+ When the N places are taken add() returns an invalid id and calls the
+ InlineEventBase overflow handler.
+*/
+
+namespace picoevents
+{
+	template<size_t N, typename ...T>
+	class RealtimeEvent : public InlineEventBase
+	{
+		static_assert(N > 0 && N < SubscriptionID::Invalid, "RealtimeEvent needs room for at least one callback");
+	public:
+		using Callback = std::function<void(T...)>;
+		using CallbackID = SubscriptionID;
+		static constexpr size_t Capacity = N;
+
+		RealtimeEvent()
+		{
+			for (size_t i = 0; i < N; i++) _free[i] = (uint32_t)(N - 1 - i);
+		}
+		RealtimeEvent(const RealtimeEvent&) = delete;
+		RealtimeEvent& operator=(const RealtimeEvent&) = delete;
+		// nobody can use the event anymore, no need to go through the queues
+		~RealtimeEvent()
+		{
+			while (Change* c = _changes.pop())
+			{
+				if (c->op == Change::Add) c->destroy(c->context);
+				delete c;
+			}
+			for (size_t i = 0; i < _count; i++) _active[i].destroy(_active[i].context);
+			collect();
+		}
+
+		//
+		// other threads
+		//
+
+		template<typename F>
+		CallbackID add(F&& f, bool first = false)
+		{
+			using C = typename std::decay<F>::type;
+			std::lock_guard<std::mutex> lock(_mutex);
+			collectLocked();
+			if (_freeCount == 0)
+			{
+				if (overflowHandler()) overflowHandler()(N);
+				return CallbackID();
+			}
+			uint32_t slot = _free[--_freeCount];
+			Change* c = new Change();
+			c->op = Change::Add;
+			c->slot = slot;
+			c->context = new C(std::forward<F>(f));
+			c->invoke = &invokeCallable<C>;
+			c->destroy = &destroyCallable<C>;
+			c->flag = first;
+			_changes.push(c);
+			return CallbackID { slot, _generations[slot] };
+		}
+		void remove(CallbackID& id)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			collectLocked();
+			if (isValidLocked(id))
+			{
+				// the slot is reused once notify() has handed the callable back
+				_generations[id.slot]++;
+				Change* c = new Change();
+				c->op = Change::Remove;
+				c->slot = id.slot;
+				_changes.push(c);
+			}
+			id = CallbackID();
+		}
+		bool isValid(CallbackID id) const
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return isValidLocked(id);
+		}
+		void setMuted(CallbackID id, bool muted)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			collectLocked();
+			if (isValidLocked(id))
+			{
+				Change* c = new Change();
+				c->op = Change::Mute;
+				c->slot = id.slot;
+				c->flag = muted;
+				_changes.push(c);
+			}
+		}
+		// deletes the callables removed by notify()
+		void collect()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			collectLocked();
+		}
+
+		void setEnabled(bool b)
+		{
+			_enabled.store(b, std::memory_order_relaxed);
+		}
+		bool isEnabled() const
+		{
+			return _enabled.load(std::memory_order_relaxed);
+		}
+
+		//
+		// real-time thread
+		//
+
+		void notify(T... t)
+		{
+			update();
+			if (!_enabled.load(std::memory_order_relaxed)) return;
+			for (size_t i = 0; i < _count; i++)
+			{
+				if (!_active[i].muted) _active[i].invoke(_active[i].context, t...);
+			}
+		}
+		void operator()(T... t)
+		{
+			notify(t...);
+		}
+		// applies the pending changes without notifying
+		void update()
+		{
+			while (Change* c = _changes.pop()) apply(c);
+		}
+
+	private:
+		struct Change
+		{
+			enum Op { Add, Remove, Mute, Free };
+			std::atomic<Change*> next { nullptr };
+			Op op = Add;
+			uint32_t slot = 0;
+			bool flag = false;						// first for Add, muted for Mute
+			void* context = nullptr;
+			void (*invoke)(void*, T...) = nullptr;
+			void (*destroy)(void*) = nullptr;
+		};
+		struct Active
+		{
+			uint32_t slot;
+			bool muted;
+			void* context;
+			void (*invoke)(void*, T...);
+			void (*destroy)(void*);
+		};
+
+		template<typename C>
+		static void invokeCallable(void* context, T... t)
+		{
+			(*static_cast<C*>(context))(std::forward<T>(t)...);
+		}
+		template<typename C>
+		static void destroyCallable(void* context)
+		{
+			delete static_cast<C*>(context);
+		}
+
+		// real-time thread, the Change goes back to the other threads
+		void apply(Change* c)
+		{
+			size_t i = 0;
+			while (i < _count && _active[i].slot != c->slot) i++;
+			switch (c->op)
+			{
+			case Change::Add:
+				if (c->flag)
+				{
+					for (size_t j = _count; j > 0; j--) _active[j] = _active[j - 1];
+					i = 0;
+				}
+				else i = _count;
+				_active[i] = Active { c->slot, false, c->context, c->invoke, c->destroy };
+				_count++;
+				c->op = Change::Free;
+				c->context = nullptr;
+				break;
+			case Change::Remove:
+				if (i < _count)
+				{
+					c->context = _active[i].context;
+					c->destroy = _active[i].destroy;
+					for (; i + 1 < _count; i++) _active[i] = _active[i + 1];
+					_count--;
+				}
+				c->op = Change::Free;
+				break;
+			case Change::Mute:
+				if (i < _count) _active[i].muted = c->flag;
+				c->op = Change::Free;
+				break;
+			case Change::Free:
+				break;
+			}
+			_garbage.push(c);
+		}
+
+		void collectLocked()
+		{
+			while (Change* c = _garbage.pop())
+			{
+				if (c->context)
+				{
+					c->destroy(c->context);
+					// the slot of a removed callable can now be reused
+					_free[_freeCount++] = c->slot;
+				}
+				delete c;
+			}
+		}
+		bool isValidLocked(CallbackID id) const
+		{
+			return id.slot < N && _generations[id.slot] == id.generation && !isFree(id.slot);
+		}
+		bool isFree(uint32_t slot) const
+		{
+			for (size_t i = 0; i < _freeCount; i++)
+			{
+				if (_free[i] == slot) return true;
+			}
+			return false;
+		}
+
+		// other threads
+		mutable std::mutex _mutex;
+		uint32_t _generations[N] = {};
+		uint32_t _free[N];
+		size_t _freeCount = N;
+		detail::MpscQueue<Change> _changes;			// to the real-time thread
+		detail::MpscQueue<Change> _garbage;			// back from it
+		std::atomic<bool> _enabled { true };
+
+		// real-time thread
+		Active _active[N];
+		size_t _count = 0;
+	};
+}
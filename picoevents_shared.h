@@ -0,0 +1,349 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "picoevents.h"
+
+/*
+ A Value read by many threads and rarely written
+
+ picoevents::SharedValue<Settings> settings(Settings{});
+ settings.addListener(uiThread, [](const Settings& s) { ... });   // posted to uiThread
+ Settings s = settings.get();                                   // any thread, no lock
+ settings.set(newSettings);                                     // any thread
+
+ Trivially copyable types are stored in a seqlock: get() copies the value and
+ tries again if a set() was writing it meanwhile, so readers only read the
+ shared cache lines.
+ The other types are swapped by pointer (read-copy-update): read(f) calls
+ f(const T&) on the current version without copying it, the versions replaced
+ by set() are deleted once no reader can still see them. The readers only
+ write to a cache line of their own thread.
+ set() calls (in order, on the calling thread) the listeners added without an
+ executor, and posts the new value to those added with one (anything with a
+ post(std::function<void()>) method, see Executor), so that they run on their
+ owner's thread.
+ The listeners are called after the value is written, without holding the
+ writers' lock: a listener can set() the value again, the nested notification
+ runs on the same thread. Adding or removing listeners from another thread
+ waits for the notification in progress. Two threads setting at the same time
+ may notify in the opposite order from their writes, get() returns the last.
+*/
+
+namespace picoevents
+{
+	namespace detail
+	{
+		//
+		// epoch based reclamation for the SharedValues of non trivially copyable types.
+		// Each reading thread publishes the epoch it started reading in (0 when not reading)
+		//
+		class RcuDomain
+		{
+		public:
+			struct alignas(64) Reader
+			{
+				std::atomic<uint64_t> epoch { 0 };
+				std::atomic<bool> used { false };
+				int depth = 0;
+			};
+
+			static RcuDomain& global()
+			{
+				static RcuDomain d;
+				return d;
+			}
+
+			// the slot of the calling thread
+			Reader& reader()
+			{
+				struct Holder
+				{
+					Reader* r = nullptr;
+					~Holder()
+					{
+						if (r) r->used.store(false, std::memory_order_release);
+					}
+				};
+				thread_local Holder h;
+				if (!h.r) h.r = acquireReader();
+				return *h.r;
+			}
+
+			void enter(Reader& r)
+			{
+				if (r.depth++ > 0) return;
+				r.epoch.store(_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+				// the epoch must be visible before the pointer is read
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+			}
+			void leave(Reader& r)
+			{
+				if (--r.depth == 0) r.epoch.store(0, std::memory_order_release);
+			}
+
+			// after a pointer was replaced: what was retired before the returned epoch
+			// can be deleted once quiescent(epoch)
+			uint64_t advance()
+			{
+				return _epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+			}
+			bool quiescent(uint64_t epoch)
+			{
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				std::lock_guard<std::mutex> lock(_mutex);
+				for (auto& r : _readers)
+				{
+					uint64_t e = r->epoch.load(std::memory_order_acquire);
+					if (e != 0 && e < epoch) return false;
+				}
+				return true;
+			}
+
+		private:
+			Reader* acquireReader()
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				for (auto& r : _readers)
+				{
+					bool expected = false;
+					if (r->used.compare_exchange_strong(expected, true)) return r.get();
+				}
+				_readers.emplace_back(new Reader());
+				_readers.back()->used.store(true);
+				return _readers.back().get();
+			}
+
+			std::atomic<uint64_t> _epoch { 1 };
+			std::mutex _mutex;
+			std::vector<std::unique_ptr<Reader>> _readers;
+		};
+
+		// what SharedValue<T> stores, depending on T
+		template<typename T, bool Trivial = std::is_trivially_copyable<T>::value>
+		class SharedStorage;
+
+		// seqlock
+		template<typename T>
+		class SharedStorage<T, true>
+		{
+			static constexpr size_t Words = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+		public:
+			SharedStorage(const T& t)
+			{
+				store(t);
+			}
+			T load() const
+			{
+				for (;;)
+				{
+					uint64_t seq = _seq.load(std::memory_order_acquire);
+					if (seq & 1) continue;
+					uint64_t words[Words];
+					for (size_t i = 0; i < Words; i++) words[i] = _words[i].load(std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_acquire);
+					if (_seq.load(std::memory_order_relaxed) == seq)
+					{
+						alignas(T) unsigned char bytes[sizeof(T)];
+						std::memcpy(bytes, words, sizeof(T));
+						return *std::launder(reinterpret_cast<T*>(bytes));
+					}
+				}
+			}
+			template<typename F>
+			decltype(auto) read(F&& f) const
+			{
+				T t = load();
+				return f(static_cast<const T&>(t));
+			}
+			// one writer at a time
+			void store(const T& t)
+			{
+				uint64_t words[Words] = {};
+				std::memcpy(words, &t, sizeof(T));
+				uint64_t seq = _seq.load(std::memory_order_relaxed);
+				_seq.store(seq + 1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+				for (size_t i = 0; i < Words; i++) _words[i].store(words[i], std::memory_order_relaxed);
+				_seq.store(seq + 2, std::memory_order_release);
+			}
+
+		private:
+			std::atomic<uint64_t> _seq { 0 };
+			std::atomic<uint64_t> _words[Words];
+		};
+
+		// read-copy-update
+		template<typename T>
+		class SharedStorage<T, false>
+		{
+		public:
+			SharedStorage(const T& t) : _current(new T(t)) {}
+			// nobody can read anymore
+			~SharedStorage()
+			{
+				delete _current.load(std::memory_order_relaxed);
+			}
+			T load() const
+			{
+				return read([](const T& t) { return t; });
+			}
+			template<typename F>
+			decltype(auto) read(F&& f) const
+			{
+				RcuDomain& d = RcuDomain::global();
+				RcuDomain::Reader& r = d.reader();
+				struct Scope
+				{
+					RcuDomain& d;
+					RcuDomain::Reader& r;
+					~Scope()
+					{
+						d.leave(r);
+					}
+				} scope { d, r };
+				d.enter(r);
+				return f(static_cast<const T&>(*_current.load(std::memory_order_seq_cst)));
+			}
+			// one writer at a time
+			void store(const T& t)
+			{
+				std::unique_ptr<const T> previous(_current.exchange(new T(t), std::memory_order_seq_cst));
+				_retired.push_back({ RcuDomain::global().advance(), std::move(previous) });
+				reclaim();
+			}
+
+		private:
+			void reclaim()
+			{
+				RcuDomain& d = RcuDomain::global();
+				size_t n = 0;
+				// retired in increasing epochs
+				while (n < _retired.size() && d.quiescent(_retired[n].first)) n++;
+				_retired.erase(_retired.begin(), _retired.begin() + n);
+			}
+
+			std::atomic<const T*> _current;
+			std::vector<std::pair<uint64_t, std::unique_ptr<const T>>> _retired;
+		};
+	}
+
+
+	template<typename T>
+	class SharedValue : public ScopedCallbacksHolder
+	{
+	public:
+		using Callback = typename Event<const T&>::Callback;
+
+		SharedValue(const T& t) : _storage(t) {}
+		virtual ~SharedValue()
+		{
+			removeAllCallbacks(); // remove callbacks before deleting _e
+		}
+
+		// from any thread
+		T get() const
+		{
+			return _storage.load();
+		}
+		// calls f(const T&) with the current value, without copying it when T is not trivially copyable
+		template<typename F>
+		decltype(auto) read(F&& f) const
+		{
+			return _storage.read(std::forward<F>(f));
+		}
+		// from any thread, the writers are serialized
+		void set(const T& t)
+		{
+			{
+				std::lock_guard<std::mutex> lock(_writeMutex);
+				_storage.store(t);
+				_version.fetch_add(1, std::memory_order_release);
+			}
+			std::lock_guard<std::recursive_mutex> lock(_listenersMutex);
+			_e.notify(t);
+		}
+		// incremented by each set(), see ValueObserver
+		uint64_t version() const
+		{
+			return _version.load(std::memory_order_acquire);
+		}
+
+		// not locked: while other threads set() the value, use addListener() instead
+		Event<const T&>& getEvent()
+		{
+			return _e;
+		}
+		// called by set(), on the thread calling it
+		typename Event<const T&>::ScopedCallbackID* addListener(const Callback& c, bool first = false PICOEVENTS_LOCATION_PARAM)
+		{
+			std::lock_guard<std::recursive_mutex> lock(_listenersMutex);
+			return addCallback(_e, c, first PICOEVENTS_LOCATION_ARG);
+		}
+		// called on executor with a copy of the new value, executor must outlive the listener
+		template<typename Executor>
+		typename Event<const T&>::ScopedCallbackID* addListener(Executor& executor, const Callback& c, bool first = false PICOEVENTS_LOCATION_PARAM)
+		{
+			std::lock_guard<std::recursive_mutex> lock(_listenersMutex);
+			return addCallback(_e, [&executor, c](const T& t)
+			{
+				executor.post([c, t] { c(t); });
+			}, first PICOEVENTS_LOCATION_ARG);
+		}
+		// hide the ScopedCallbacksHolder ones, to take the lock addListener() takes
+		template<typename E = Event<const T&>>
+		void removeCallback(typename E::ScopedCallbackID* r)
+		{
+			std::lock_guard<std::recursive_mutex> lock(_listenersMutex);
+			ScopedCallbacksHolder::removeCallback<E>(r);
+		}
+		void removeAllCallbacks()
+		{
+			std::lock_guard<std::recursive_mutex> lock(_listenersMutex);
+			ScopedCallbacksHolder::removeAllCallbacks();
+		}
+
+	private:
+		detail::SharedStorage<T> _storage;
+		std::atomic<uint64_t> _version { 0 };
+		std::mutex _writeMutex;
+		// held while notifying, recursive so that the listeners can set(), add or remove
+		std::recursive_mutex _listenersMutex;
+		Event<const T&> _e;
+	};
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstdio>
+
+#include "picoevents_allocations.h"
+#include "check.h"
+
+// checks that the replaced operator new counts (else every budget would pass),
+// to be called first by the tests linked to picoevents_allocation_counter
+inline void checkAllocationCounter()
+{
+	picoevents::ScopedAllocationCount count;
+	// a new-expression paired with its delete can be optimized away, not these calls
+	void* volatile p = ::operator new(16);
+	::operator delete(p);
+	CHECK(count.get().allocations == 1 && count.get().frees == 1);
+}
+
+// calls f once (it may grow arrays), then checks that it doesn't allocate in the
+// steady state and prints the allocations and bytes per call
+template<typename F>
+void checkNoAllocations(const char* name, F&& f, int calls = 1000)
+{
+	f();
+	picoevents::ScopedAllocationCount count;
+	{
+		picoevents::ScopedAllocationBudget budget(name, 0);
+		for (int i = 0; i < calls; i++) f();
+	}
+	picoevents::AllocationCounter::Counts c = count.get();
+	printf("%-46s %g allocations, %g bytes per call\n", name, double(c.allocations) / calls, double(c.bytes) / calls);
+}
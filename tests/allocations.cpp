@@ -0,0 +1,94 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// The steady state of the dispatch paths doesn't allocate: Event::notify (with
+// lambdas, std::function callbacks and member delegates), Value::set and
+// Notifier::trigger, under the counting operator new of picoevents_allocations.h.
+// An allocation added to one of them aborts with the name of the path.
+
+#undef NDEBUG
+
+#include <functional>
+#include <string>
+
+#include "picoevents.h"
+#include "allocation_counter.h"
+
+namespace
+{
+	struct Listener
+	{
+		int calls = 0;
+		void onChanged(int)
+		{
+			calls++;
+		}
+	};
+}
+
+int main()
+{
+	checkAllocationCounter();
+
+	int sum = 0;
+	picoevents::Event<int> changed;
+	Listener listener;
+	for (int i = 0; i < 16; i++) changed.add([&sum, i](int v) { sum += v + i; });
+	changed.add(std::function<void(int)>([&sum](int v) { sum -= v; }));
+	changed.add(picoevents::member<&Listener::onChanged>(&listener));
+	checkNoAllocations("Event<int>::notify", [&] { changed.notify(1); });
+	CHECK(listener.calls == 1001);
+
+	size_t length = 0;
+	picoevents::Event<const std::string&> renamed;
+	for (int i = 0; i < 4; i++) renamed.add([&length](const std::string& s) { length += s.size(); });
+	std::string name(100, 'x');
+	checkNoAllocations("Event<const std::string&>::notify", [&] { renamed.notify(name); });
+
+	// skipping a muted callback
+	picoevents::SubscriptionID muted = changed.add([](int) { CHECK(false); });
+	changed.setMuted(muted, true);
+	checkNoAllocations("Event<int>::notify, muted", [&] { changed.notify(2); });
+
+	picoevents::Value<int> value(0);
+	value.addListener([&sum](int v) { sum += v; });
+	int next = 0;
+	checkNoAllocations("Value<int>::set", [&] { value.set(++next); });
+
+	// Value<std::string> passes a copy to each listener, by reference it doesn't allocate
+	picoevents::Value<std::string, const std::string&> text("");
+	text.addListener([&length](const std::string& s) { length += s.size(); });
+	checkNoAllocations("Value<std::string, const&>::set", [&] { text.set(name); });
+
+	auto notifier = changed.makeNotifier(3);
+	checkNoAllocations("Event<int>::Notifier::trigger", [&] { notifier.trigger(); });
+	auto textNotifier = renamed.makeNotifier(name);
+	checkNoAllocations("Event<const std::string&>::Notifier::trigger", [&] { textNotifier.trigger(); });
+
+	printf("%d %zu\n", sum, length);
+	return 0;
+}
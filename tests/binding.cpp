@@ -0,0 +1,156 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// bind(): a change goes once through each binding (no echo back to the value it
+// came from, even when the converters don't round-trip), along chains of
+// bindings, refuses cycles, and survives a binding deleted by a listener while
+// it is propagating.
+
+#include <memory>
+
+#include "picoevents_binding.h"
+#include "check.h"
+
+namespace
+{
+	void twoWayWithoutEcho()
+	{
+		picoevents::BindingGraph graph;
+		picoevents::Value<int> a(1), b(0);
+		int aCalls = 0, bCalls = 0;
+		a.addListener([&aCalls](int) { aCalls++; });
+		b.addListener([&bCalls](int) { bCalls++; });
+
+		auto binding = picoevents::bind(a, b, graph);
+		CHECK(binding && b.get() == 1);
+		CHECK(aCalls == 0 && bCalls == 1);
+
+		a.set(2);
+		CHECK(b.get() == 2 && aCalls == 1 && bCalls == 2);
+		b.set(3);
+		CHECK(a.get() == 3 && aCalls == 2 && bCalls == 3);
+	}
+
+	void convertersThatDontRoundTrip()
+	{
+		picoevents::BindingGraph graph;
+		picoevents::Value<int> steps(4);
+		picoevents::Value<float> position(0.f);
+		int stepCalls = 0, positionCalls = 0;
+		steps.addListener([&stepCalls](int) { stepCalls++; });
+		position.addListener([&positionCalls](float) { positionCalls++; });
+
+		auto binding = picoevents::bind(steps, position,
+			[](int s) { return s * 0.5f; },
+			[](float p) { return (int)(p * 2.f); }, graph);
+		CHECK(binding && position.get() == 2.f);
+
+		// 1.3 gives 2 steps, which would give back 1.0: not propagated again
+		position.set(1.3f);
+		CHECK(steps.get() == 2 && position.get() == 1.3f);
+		CHECK(stepCalls == 1 && positionCalls == 2);
+	}
+
+	void chainsAndCycles()
+	{
+		picoevents::BindingGraph graph;
+		picoevents::Value<int> a(1), b(0), c(0);
+		int calls[3] = {};
+		a.addListener([&calls](int) { calls[0]++; });
+		b.addListener([&calls](int) { calls[1]++; });
+		c.addListener([&calls](int) { calls[2]++; });
+
+		auto ab = picoevents::bind(a, b, graph);
+		auto bc = picoevents::bind(b, c, graph);
+		CHECK(ab && bc && c.get() == 1);
+		// a and c are already connected
+		CHECK(!picoevents::bind(a, c, graph) && !picoevents::bind(c, a, graph));
+		CHECK(graph.connected(&a, &c));
+
+		calls[0] = calls[1] = calls[2] = 0;
+		c.set(5);
+		CHECK(a.get() == 5 && b.get() == 5);
+		CHECK(calls[0] == 1 && calls[1] == 1 && calls[2] == 1);
+
+		bc.reset();
+		CHECK(!graph.connected(&a, &c));
+		a.set(6);
+		CHECK(b.get() == 6 && c.get() == 5);
+		auto ca = picoevents::bind(c, a, graph);
+		CHECK(ca && a.get() == 5 && b.get() == 5);
+	}
+
+	void listenerStartsItsOwnPropagation()
+	{
+		picoevents::BindingGraph graph;
+		picoevents::Value<int> a(0), b(0), c(0), d(0);
+		auto ab = picoevents::bind(a, b, graph);
+		auto cd = picoevents::bind(c, d, graph);
+		// not a binding: sets c when b changes, c then propagates to d
+		b.addListener([&c](int v) { c.set(v * 10); });
+		a.set(2);
+		CHECK(b.get() == 2 && c.get() == 20 && d.get() == 20);
+	}
+
+	void unbindWhilePropagating()
+	{
+		picoevents::BindingGraph graph;
+		picoevents::Value<int> a(0), b(0), c(0);
+		auto ab = picoevents::bind(a, b, graph);
+		auto bc = picoevents::bind(b, c, graph);
+		int bCalls = 0;
+		// deletes both bindings while the change of a goes through them
+		b.addListener([&](int v) {
+			bCalls++;
+			if (v == 3)
+			{
+				ab.reset();
+				bc.reset();
+			}
+		});
+		a.set(3);
+		CHECK(b.get() == 3 && bCalls == 1);
+		CHECK(!graph.connected(&a, &b) && !graph.connected(&b, &c));
+
+		a.set(4);
+		c.set(5);
+		CHECK(b.get() == 3 && bCalls == 1);
+		// and the values can be bound again
+		ab = picoevents::bind(a, b, graph);
+		CHECK(ab && b.get() == 4 && bCalls == 2);
+	}
+}
+
+int main()
+{
+	twoWayWithoutEcho();
+	convertersThatDontRoundTrip();
+	chainsAndCycles();
+	listenerStartsItsOwnPropagation();
+	unbindWhilePropagating();
+	return 0;
+}
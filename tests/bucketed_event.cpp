@@ -0,0 +1,211 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// BucketedEvent: the callbacks are called by bucket (one per callable type, in
+// order of creation), then in order of addition; the callbacks added while
+// notifying wait for the next notification, the removed ones (the current one
+// included) are not called anymore and stay alive until the notification ends.
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "picoevents_bucketed.h"
+#include "check.h"
+
+namespace
+{
+	using Calls = std::vector<int>;
+
+	// a different closure type for each K, all recording their tag
+	template<int K>
+	auto recorder(Calls& calls, int tag)
+	{
+		return [&calls, tag](int) { calls.push_back(K * 1000 + tag); };
+	}
+
+	void dispatchesByBucket()
+	{
+		picoevents::BucketedEvent<int> event;
+		Calls calls;
+		event.add(recorder<1>(calls, 0));
+		event.add(recorder<2>(calls, 1));
+		event.add(recorder<1>(calls, 2));
+		event.add(recorder<3>(calls, 3));
+		event.add(recorder<2>(calls, 4));
+		CHECK(event.size() == 5);
+		event.notify(0);
+		CHECK((calls == Calls { 1000, 1002, 2001, 2004, 3003 }));
+
+		calls.clear();
+		event.setEnabled(false);
+		event.notify(0);
+		CHECK(calls.empty());
+	}
+
+	void addsWhileNotifying()
+	{
+		picoevents::BucketedEvent<int> event;
+		Calls calls;
+		bool added = false;
+		event.add([&](int) {
+			calls.push_back(0);
+			if (added) return;
+			added = true;
+			// same type as a bucket being notified, and a new type
+			event.add(recorder<1>(calls, 10));
+			event.add(recorder<2>(calls, 11));
+		});
+		event.add(recorder<1>(calls, 1));
+		event.notify(0);
+		CHECK((calls == Calls { 0, 1001 }));
+		CHECK(event.size() == 4);
+
+		calls.clear();
+		event.notify(0);
+		CHECK((calls == Calls { 0, 1001, 1010, 2011 }));
+	}
+
+	void removesWhileNotifying()
+	{
+		picoevents::BucketedEvent<int> event;
+		Calls calls;
+		picoevents::SubscriptionID first, self, later, added;
+		first = event.add(recorder<1>(calls, 0));
+		// removes an earlier callback, itself, a later one, and one it added
+		self = event.add([&, name = std::string("a capture long enough to be on the heap")](int) {
+			calls.push_back(1);
+			event.remove(first);
+			event.remove(self);
+			event.remove(later);
+			added = event.add(recorder<2>(calls, 5));
+			event.remove(added);
+			// the removed closure is still alive while it runs
+			CHECK(name == "a capture long enough to be on the heap");
+			calls.push_back(2);
+		});
+		later = event.add([&calls](int) { calls.push_back(3); });
+		event.add(recorder<1>(calls, 4));
+		event.notify(0);
+		// the last one is in the bucket of the first
+		CHECK((calls == Calls { 1000, 1004, 1, 2 }));
+		CHECK(!event.isValid(first) && !event.isValid(self) && !event.isValid(later) && !event.isValid(added));
+		CHECK(event.size() == 1);
+
+		calls.clear();
+		event.notify(0);
+		CHECK((calls == Calls { 1004 }));
+
+		// in the same bucket: the first one removes the next one
+		picoevents::BucketedEvent<int> same;
+		std::vector<picoevents::SubscriptionID> ids(2);
+		calls.clear();
+		for (int i = 0; i < 2; i++)
+		{
+			ids[i] = same.add([&, i](int) {
+				calls.push_back(i);
+				same.remove(ids[1 - i]);
+			});
+		}
+		same.notify(0);
+		same.notify(0);
+		CHECK((calls == Calls { 0, 0 }));
+	}
+
+	void reusesSlots()
+	{
+		picoevents::BucketedEvent<int> event;
+		Calls calls;
+		picoevents::SubscriptionID a = event.add(recorder<1>(calls, 0));
+		picoevents::SubscriptionID stale = a;
+		event.remove(a);
+		CHECK(!event.isValid(a) && !event.isValid(stale));
+		picoevents::SubscriptionID b = event.add(recorder<1>(calls, 1));
+		CHECK(b.slot == stale.slot && !event.isValid(stale));
+		// removing with the stale id leaves the new callback alone
+		event.remove(stale);
+		CHECK(event.isValid(b));
+		{
+			picoevents::BucketedEvent<int>::ScopedCallbackID scoped(event, recorder<2>(calls, 2));
+			event.notify(0);
+		}
+		event.notify(0);
+		CHECK((calls == Calls { 1001, 2002, 1001 }));
+	}
+
+	// random removals (compacting the buckets), from outside and while notifying
+	void randomRemovals()
+	{
+		std::mt19937 random(7);
+		picoevents::BucketedEvent<int> event;
+		Calls calls;
+		std::vector<picoevents::SubscriptionID> ids;
+		std::vector<int> expected;
+		for (int i = 0; i < 300; i++)
+		{
+			ids.push_back(i % 2 ? event.add(recorder<1>(calls, i)) : event.add(recorder<2>(calls, i)));
+		}
+		auto check = [&] {
+			calls.clear();
+			event.notify(0);
+			Calls sorted;
+			for (int k : { 1, 2 })
+			{
+				for (size_t i = 0; i < ids.size(); i++)
+				{
+					if (event.isValid(ids[i]) && (i % 2 ? 1 : 2) == k) sorted.push_back(k * 1000 + (int)i);
+				}
+			}
+			// bucket 2 was created first
+			Calls ordered;
+			for (int c : sorted) if (c >= 2000) ordered.push_back(c);
+			for (int c : sorted) if (c < 2000) ordered.push_back(c);
+			CHECK(calls == ordered);
+		};
+		for (int round = 0; round < 20; round++)
+		{
+			for (int r = 0; r < 5; r++) event.remove(ids[random() % ids.size()]);
+			check();
+			picoevents::SubscriptionID remover = event.add([&](int) {
+				for (int r = 0; r < 5; r++) event.remove(ids[random() % ids.size()]);
+			});
+			event.notify(0);
+			event.remove(remover);
+			check();
+		}
+	}
+}
+
+int main()
+{
+	dispatchesByBucket();
+	addsWhileNotifying();
+	removesWhileNotifying();
+	reusesSlots();
+	randomRemovals();
+	return 0;
+}
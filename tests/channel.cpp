@@ -0,0 +1,134 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Channel: messages are moved, not copied, through push / tryPush / dispatch
+// (move-only messages included), and two threads exchanging many more messages
+// than the capacity see them all, in order, with or without Wakeup::Notify.
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "picoevents_channel.h"
+#include "check.h"
+
+namespace
+{
+	struct Counted
+	{
+		static int copies;
+		int value = 0;
+
+		explicit Counted(int v) : value(v) {}
+		Counted(const Counted& other) : value(other.value) { copies++; }
+		Counted(Counted&& other) noexcept : value(other.value) { other.value = -1; }
+		Counted& operator=(const Counted&) = delete;
+		Counted& operator=(Counted&&) = delete;
+	};
+	int Counted::copies = 0;
+
+	void movesMessages()
+	{
+		picoevents::Channel<Counted> channel(4);
+		channel.push(Counted(1));
+		CHECK(channel.tryPush(Counted(2)));
+		int sum = 0;
+		channel.addListener([&sum](const Counted& c) { sum += c.value; });
+		CHECK(channel.dispatch() == 2);
+		CHECK(sum == 3);
+		CHECK(Counted::copies == 0);
+
+		// arguments taken by reference are copied, the caller's value is left alone
+		picoevents::Channel<std::string&> names(4);
+		std::string name = "a name long enough not to be stored inline";
+		names.push(name);
+		CHECK(name == "a name long enough not to be stored inline");
+		std::string received;
+		CHECK(names.consume([&received](std::string& s) { received = std::move(s); }) == 1);
+		CHECK(received == name);
+	}
+
+	void moveOnlyMessages()
+	{
+		picoevents::Channel<std::unique_ptr<int>> channel(2);
+		channel.push(std::make_unique<int>(1));
+		CHECK(channel.tryPush(std::make_unique<int>(2)));
+		CHECK(!channel.tryPush(std::make_unique<int>(3)));
+
+		std::unique_ptr<int> kept;
+		CHECK(channel.consume([&kept](std::unique_ptr<int>& p) { kept = std::move(p); }, 1) == 1);
+		CHECK(kept && *kept == 1);
+
+		int received = 0;
+		channel.addListener([&received](std::unique_ptr<int> p) { received = *p; });
+		CHECK(channel.dispatch() == 1);
+		CHECK(received == 2);
+		// destroyed with a message left in the ring
+		channel.push(std::make_unique<int>(4));
+	}
+
+	// the producer pushes 0, 1, 2... as fast as it can, the consumer checks
+	// that it gets each of them once, in order
+	void twoThreads(picoevents::Channel<size_t, std::unique_ptr<size_t>>::Wakeup wakeup)
+	{
+		const size_t count = 200000;
+		picoevents::Channel<size_t, std::unique_ptr<size_t>> channel(64, wakeup);
+		std::thread producer([&channel, count] {
+			for (size_t i = 0; i < count; i++)
+			{
+				if (i & 1) channel.push(i, std::make_unique<size_t>(i));
+				else while (!channel.tryPush(i, std::make_unique<size_t>(i))) std::this_thread::yield();
+			}
+		});
+
+		size_t next = 0;
+		bool inOrder = true;
+		auto check = [&next, &inOrder](size_t i, std::unique_ptr<size_t>& p) {
+			inOrder &= i == next && p && *p == next;
+			next++;
+		};
+		while (next < count)
+		{
+			if (wakeup == decltype(channel)::Wakeup::Notify) channel.wait();
+			// small batches, so that the indices wrap around at different places
+			if (!channel.consume(check, 1 + next % 7) && wakeup == decltype(channel)::Wakeup::None) std::this_thread::yield();
+		}
+		producer.join();
+		CHECK(inOrder);
+		CHECK(next == count);
+		CHECK(channel.empty());
+	}
+}
+
+int main()
+{
+	movesMessages();
+	moveOnlyMessages();
+	twoThreads(picoevents::Channel<size_t, std::unique_ptr<size_t>>::Wakeup::None);
+	twoThreads(picoevents::Channel<size_t, std::unique_ptr<size_t>>::Wakeup::Notify);
+	return 0;
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// ValueVector / ValueMap against a shadow copy: random operations, in and out
+// of batches, and a listener applying each diff to the shadow the way a view
+// would (re-reading only the inserted and updated elements). Every element
+// the diffs say untouched must still be the same; the values are never
+// reused, so a wrong diff can't be hidden by an equal value.
+
+#include <map>
+#include <random>
+#include <vector>
+
+#include "picoevents_containers.h"
+#include "check.h"
+
+namespace
+{
+	void vectorDiffs()
+	{
+		std::mt19937 random(52);
+		int next = 0;
+		picoevents::ValueVector<int> rows;
+		// what the view shows, -1 for the elements to re-read
+		std::vector<int> shadow;
+		int diffs = 0;
+		rows.addListener([&](const picoevents::VectorDiff& diff) {
+			CHECK(!diff.empty());
+			diffs++;
+			for (auto& c : diff.changes)
+			{
+				switch (c.op)
+				{
+				case picoevents::VectorDiff::Op::Insert:
+					CHECK(c.index <= shadow.size());
+					shadow.insert(shadow.begin() + c.index, c.count, -1);
+					break;
+				case picoevents::VectorDiff::Op::Erase:
+					CHECK(c.index + c.count <= shadow.size());
+					shadow.erase(shadow.begin() + c.index, shadow.begin() + c.index + c.count);
+					break;
+				case picoevents::VectorDiff::Op::Update:
+					CHECK(c.index + c.count <= shadow.size());
+					std::fill(shadow.begin() + c.index, shadow.begin() + c.index + c.count, -1);
+					break;
+				case picoevents::VectorDiff::Op::Move:
+				{
+					CHECK(c.index + c.count <= shadow.size());
+					std::vector<int> moved(shadow.begin() + c.index, shadow.begin() + c.index + c.count);
+					shadow.erase(shadow.begin() + c.index, shadow.begin() + c.index + c.count);
+					CHECK(c.to <= shadow.size());
+					shadow.insert(shadow.begin() + c.to, moved.begin(), moved.end());
+					break;
+				}
+				}
+			}
+			CHECK(shadow.size() == rows.size());
+			for (size_t i = 0; i < shadow.size(); i++)
+			{
+				CHECK(shadow[i] == -1 || shadow[i] == rows[i]);
+				shadow[i] = rows[i];
+			}
+		});
+
+		auto operation = [&] {
+			size_t size = rows.size();
+			switch (random() % 8)
+			{
+			case 0:
+			case 1:
+				rows.push_back(next++);
+				break;
+			case 2:
+				rows.insert(random() % (size + 1), next++);
+				break;
+			case 3:
+			{
+				int values[3] = { next, next + 1, next + 2 };
+				next += 3;
+				rows.insert(random() % (size + 1), values, values + 1 + random() % 3);
+				break;
+			}
+			case 4:
+				if (size) rows.erase(random() % size);
+				break;
+			case 5:
+				if (size > 3)
+				{
+					size_t at = random() % (size - 3);
+					rows.erase(at, 1 + random() % 3);
+				}
+				break;
+			case 6:
+				if (size) rows.update(random() % size, next++);
+				break;
+			case 7:
+				if (size > 2)
+				{
+					size_t count = 1 + random() % 2;
+					size_t from = random() % (size - count + 1);
+					rows.move(from, random() % (size - count + 1), count);
+				}
+				break;
+			}
+		};
+
+		for (int round = 0; round < 2000; round++)
+		{
+			if (round % 3 == 0)
+			{
+				picoevents::ValueVector<int>::ScopedBatch batch(rows);
+				for (int i = 0; i < 10; i++) operation();
+			}
+			else operation();
+			if (round % 500 == 499) rows.clear();
+		}
+		CHECK(shadow == rows.get());
+		CHECK(diffs > 1000);
+	}
+
+	void mapDiffs()
+	{
+		std::mt19937 random(520);
+		int next = 0;
+		picoevents::ValueMap<int, int> map;
+		std::map<int, int> shadow;
+		map.addListener([&](const picoevents::MapDiff<int>& diff) {
+			CHECK(!diff.empty());
+			for (auto& c : diff.changes)
+			{
+				const int* v = map.find(c.key);
+				switch (c.op)
+				{
+				case picoevents::MapDiff<int>::Op::Insert:
+					CHECK(shadow.count(c.key) == 0 && v);
+					shadow[c.key] = *v;
+					break;
+				case picoevents::MapDiff<int>::Op::Erase:
+					CHECK(shadow.count(c.key) == 1 && !v);
+					shadow.erase(c.key);
+					break;
+				case picoevents::MapDiff<int>::Op::Update:
+					CHECK(shadow.count(c.key) == 1 && v);
+					shadow[c.key] = *v;
+					break;
+				}
+			}
+			CHECK(shadow == map.get());
+		});
+
+		auto operation = [&] {
+			int key = (int)(random() % 40);
+			if (random() % 3 == 0) map.erase(key);
+			else map.set(key, next++);
+		};
+		for (int round = 0; round < 2000; round++)
+		{
+			if (round % 3 == 0)
+			{
+				picoevents::ValueMap<int, int>::ScopedBatch batch(map);
+				for (int i = 0; i < 10; i++) operation();
+			}
+			else operation();
+			if (round % 500 == 499) map.clear();
+		}
+		CHECK(shadow == map.get());
+	}
+}
+
+int main()
+{
+	vectorDiffs();
+	mapDiffs();
+	return 0;
+}
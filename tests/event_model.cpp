@@ -0,0 +1,485 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Random sequences of add / add first / remove / mute / replace / notify on an
+// Event (the one of a Value), including changes made from inside the callbacks,
+// ScopedCallbacksHolder lifetimes and member delegates removed by value, checked against a simple model of the
+// same semantics. Each callback logs its calls and, when called, runs one more
+// operation.
+//
+// Built as a test replaying pseudo-random inputs (or the files given as
+// arguments), and with clang as a libFuzzer target (PICOEVENTS_BUILD_FUZZERS).
+
+#undef NDEBUG
+#if !defined(PICOEVENTS_CHECK_INVARIANTS)
+#define PICOEVENTS_CHECK_INVARIANTS
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "picoevents.h"
+#include "check.h"
+
+namespace
+{
+	enum Op : uint8_t
+	{
+		Add,
+		AddFirst,
+		AddToHolder,
+		Remove,
+		Mute,
+		Unmute,
+		Replace,
+		Set,
+		NewHolder,
+		DeleteHolder,
+		AddMember,
+		Nothing,
+		OpCount
+	};
+
+	// run once by the harness, or by a callback each time it is called
+	struct Action
+	{
+		uint8_t op;
+		uint8_t arg;
+	};
+
+	// the action given to the callbacks added by another callback
+	Action derived(uint8_t arg)
+	{
+		return Action { uint8_t((arg * 7 + 3) % OpCount), uint8_t(arg * 13 + 5) };
+	}
+
+	constexpr int MaxSubscriptions = 128;
+	constexpr size_t MaxHolders = 8;
+	constexpr int MaxDepth = 2;
+	constexpr size_t MaxCalls = 4000;
+
+	struct Call
+	{
+		int tag;
+		int value;
+		bool operator==(const Call& other) const
+		{
+			return tag == other.tag && value == other.value;
+		}
+	};
+
+	//
+	// the reference model: the callbacks in notification order, in a plain vector
+	//
+	class Model
+	{
+	public:
+		std::vector<Call> calls;
+
+		void run(Action a)
+		{
+			switch (a.op)
+			{
+			case Add:
+			case AddMember:
+			case AddFirst:
+			case AddToHolder:
+			{
+				if (_nextSubscription == MaxSubscriptions) return;
+				int holder = -1;
+				if (a.op == AddToHolder)
+				{
+					if (_holders.empty() || !_holders[a.arg % _holders.size()]) return;
+					holder = int(a.arg % _holders.size());
+				}
+				Record r { _nextSubscription++, _nextTag++, derived(a.arg), false, true, holder };
+				if (a.op == AddFirst && _depth == 0) _order.insert(_order.begin(), r);
+				else
+				{
+					// added first while notifying: moved to the front once it is over
+					_order.push_back(r);
+					if (a.op == AddFirst) _pendingFront.push_back(r.subscription);
+				}
+				break;
+			}
+			case Remove:
+			{
+				Record* r = find(a.arg);
+				if (r) _order.erase(_order.begin() + (r - _order.data()));
+				break;
+			}
+			case Mute:
+			case Unmute:
+			{
+				Record* r = find(a.arg);
+				if (!r || r->holder >= 0) break;
+				r->muted = a.op == Mute;
+				// unmuted while notifying: called from the next notification
+				if (r->muted || _depth == 0) r->active = !r->muted;
+				else _pendingUnmute.push_back(r->subscription);
+				break;
+			}
+			case Replace:
+			{
+				Record* r = find(a.arg);
+				if (r && r->holder < 0)
+				{
+					r->tag = _nextTag++;
+					r->action = derived(a.arg);
+				}
+				break;
+			}
+			case Set:
+				if (_depth < MaxDepth) notify(a.arg);
+				break;
+			case NewHolder:
+				if (_holders.size() < MaxHolders) _holders.push_back(true);
+				break;
+			case DeleteHolder:
+			{
+				if (_holders.empty()) return;
+				size_t h = a.arg % _holders.size();
+				if (!_holders[h]) return;
+				_holders[h] = false;
+				for (size_t i = 0; i < _order.size();)
+				{
+					if (_order[i].holder == int(h)) _order.erase(_order.begin() + i);
+					else i++;
+				}
+				break;
+			}
+			}
+		}
+
+		// of each subscription, -1: removed, 0: active, 1: muted
+		std::vector<int> states() const
+		{
+			std::vector<int> res(_nextSubscription, -1);
+			for (const Record& r : _order) res[r.subscription] = r.muted ? 1 : 0;
+			return res;
+		}
+
+	private:
+		struct Record
+		{
+			int subscription;
+			int tag;				// of the callable, changed by Replace
+			Action action;
+			bool muted;
+			bool active;			// not muted, nor unmuted during the current notification
+			int holder;
+		};
+
+		Record* find(uint8_t arg)
+		{
+			if (_nextSubscription == 0) return nullptr;
+			int subscription = arg % _nextSubscription;
+			for (Record& r : _order)
+			{
+				if (r.subscription == subscription) return &r;
+			}
+			return nullptr;
+		}
+
+		void notify(int value)
+		{
+			_depth++;
+			// the callbacks to call, a callback removed or muted before its turn is skipped
+			std::vector<int> todo;
+			for (const Record& r : _order)
+			{
+				if (r.active) todo.push_back(r.subscription);
+			}
+			for (int subscription : todo)
+			{
+				Record* r = nullptr;
+				for (Record& o : _order)
+				{
+					if (o.subscription == subscription) r = &o;
+				}
+				if (!r || !r->active) continue;
+				calls.push_back(Call { r->tag, value });
+				if (calls.size() < MaxCalls) run(r->action);
+			}
+			if (--_depth == 0)
+			{
+				for (int subscription : _pendingFront)
+				{
+					for (size_t i = 0; i < _order.size(); i++)
+					{
+						if (_order[i].subscription != subscription) continue;
+						Record r = _order[i];
+						_order.erase(_order.begin() + i);
+						_order.insert(_order.begin(), r);
+						break;
+					}
+				}
+				_pendingFront.clear();
+				for (int subscription : _pendingUnmute)
+				{
+					for (Record& r : _order)
+					{
+						if (r.subscription == subscription && !r.muted) r.active = true;
+					}
+				}
+				_pendingUnmute.clear();
+			}
+		}
+
+		std::vector<Record> _order;
+		std::vector<int> _pendingFront;
+		std::vector<int> _pendingUnmute;
+		std::vector<bool> _holders;		// false once deleted
+		int _nextSubscription = 0;
+		int _nextTag = 0;
+		int _depth = 0;
+	};
+
+	//
+	// the same operations on a Value<int>
+	//
+	class Harness
+	{
+	public:
+		using E = picoevents::Event<int>;
+		std::vector<Call> calls;
+
+		~Harness()
+		{
+			_holders.clear();
+		}
+
+		void run(Action a)
+		{
+			switch (a.op)
+			{
+			case Add:
+			case AddMember:
+			case AddFirst:
+			case AddToHolder:
+			{
+				if (int(_subscriptions.size()) == MaxSubscriptions) return;
+				Subscription s;
+				if (a.op == AddMember)
+				{
+					_listeners.push_back(Listener { this, _nextTag++, derived(a.arg) });
+					s.listener = &_listeners.back();
+					s.id = event().add(picoevents::member<&Listener::on>(s.listener));
+				}
+				else if (a.op == AddToHolder)
+				{
+					if (_holders.empty() || !_holders[a.arg % _holders.size()]) return;
+					s.holder = int(a.arg % _holders.size());
+					s.scoped = _holders[s.holder]->addCallback(event(), callback(_nextTag++, derived(a.arg)));
+				}
+				else
+				{
+					s.id = event().add(callback(_nextTag++, derived(a.arg)), a.op == AddFirst);
+				}
+				_subscriptions.push_back(s);
+				break;
+			}
+			case Remove:
+			{
+				if (Subscription* s = find(a.arg))
+				{
+					if (s->listener && !s->replaced)
+					{
+						// by value, through the delegates index
+						bool valid = event().isValid(s->id);
+						CHECK(event().remove(picoevents::member<&Listener::on>(s->listener)) == valid);
+						s->id = E::CallbackID();
+					}
+					else if (s->holder < 0) event().remove(s->id);
+					else if (s->scoped)
+					{
+						_holders[s->holder]->removeCallback<E>(s->scoped);
+						s->scoped = nullptr;
+					}
+				}
+				break;
+			}
+			case Mute:
+			case Unmute:
+			{
+				Subscription* s = find(a.arg);
+				if (s && s->holder < 0) event().setMuted(s->id, a.op == Mute);
+				break;
+			}
+			case Replace:
+			{
+				Subscription* s = find(a.arg);
+				if (s && s->holder < 0 && event().isValid(s->id))
+				{
+					E::Callback c = callback(_nextTag++, derived(a.arg));
+					CHECK(event().replace(s->id, c));
+					s->replaced = true;
+				}
+				break;
+			}
+			case Set:
+				if (_depth < MaxDepth)
+				{
+					_depth++;
+					_value.set(a.arg);
+					_depth--;
+				}
+				break;
+			case NewHolder:
+				if (_holders.size() < MaxHolders) _holders.emplace_back(new picoevents::ScopedCallbacksHolder());
+				break;
+			case DeleteHolder:
+			{
+				if (_holders.empty()) return;
+				size_t h = a.arg % _holders.size();
+				if (!_holders[h]) return;
+				// deletes the ScopedCallbackIDs, maybe the one of the running callback
+				_holders[h].reset();
+				for (Subscription& s : _subscriptions)
+				{
+					if (s.holder == int(h)) s.scoped = nullptr;
+				}
+				break;
+			}
+			}
+		}
+
+		int state(int subscription)
+		{
+			const Subscription& s = _subscriptions[subscription];
+			if (s.holder >= 0) return s.scoped ? 0 : -1;
+			if (!event().isValid(s.id)) return -1;
+			return event().isMuted(s.id) ? 1 : 0;
+		}
+
+	private:
+		// subscribed with picoevents::member()
+		struct Listener
+		{
+			Harness* harness;
+			int tag;
+			Action action;
+			void on(int v)
+			{
+				harness->called(tag, v, action);
+			}
+		};
+		struct Subscription
+		{
+			E::CallbackID id;
+			int holder = -1;
+			E::ScopedCallbackID* scoped = nullptr;
+			Listener* listener = nullptr;
+			bool replaced = false;
+		};
+
+		E& event()
+		{
+			return _value.getEvent();
+		}
+		Subscription* find(uint8_t arg)
+		{
+			if (_subscriptions.empty()) return nullptr;
+			return &_subscriptions[arg % _subscriptions.size()];
+		}
+		std::function<void(int)> callback(int tag, Action a)
+		{
+			return [this, tag, a](int v)
+			{
+				called(tag, v, a);
+				// reads the captures again: the callable must still be alive,
+				// even if run() removed or replaced it
+				_lastReturned = tag;
+			};
+		}
+		void called(int tag, int v, Action a)
+		{
+			calls.push_back(Call { tag, v });
+			if (calls.size() < MaxCalls) run(a);
+		}
+
+		picoevents::Value<int> _value { 0 };
+		std::vector<std::unique_ptr<picoevents::ScopedCallbacksHolder>> _holders;	// nullptr once deleted
+		std::vector<Subscription> _subscriptions;
+		std::deque<Listener> _listeners;
+		int _nextTag = 0;
+		int _depth = 0;
+		int _lastReturned = -1;
+	};
+
+	void run(const uint8_t* data, size_t size)
+	{
+		Model model;
+		Harness harness;
+		size_t checked = 0;
+		for (size_t i = 0; i + 1 < size; i += 2)
+		{
+			Action a { uint8_t(data[i] % OpCount), data[i + 1] };
+			model.run(a);
+			harness.run(a);
+			CHECK(harness.calls.size() == model.calls.size());
+			for (; checked < model.calls.size(); checked++) CHECK(harness.calls[checked] == model.calls[checked]);
+			std::vector<int> states = model.states();
+			for (size_t s = 0; s < states.size(); s++) CHECK(harness.state(int(s)) == states[s]);
+		}
+	}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	run(data, size);
+	return 0;
+}
+
+#if !defined(PICOEVENTS_LIBFUZZER)
+int main(int argc, char** argv)
+{
+	// replays the inputs given as files (e.g. a crash found by the fuzzer)
+	for (int i = 1; i < argc; i++)
+	{
+		std::ifstream f(argv[i], std::ios::binary);
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+		run(data.data(), data.size());
+	}
+	if (argc > 1) return 0;
+	std::mt19937 random(1234);
+	for (int i = 0; i < 1000; i++)
+	{
+		std::vector<uint8_t> data(random() % 512);
+		for (uint8_t& b : data) b = uint8_t(random());
+		run(data.data(), data.size());
+	}
+	printf("ok\n");
+	return 0;
+}
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Executor under contention: several threads post tasks, the tasks post more
+// from the workers (to their own deques, stolen by the others) and to the main
+// thread; every task must run exactly once, in each of the idle modes.
+// Meant to be run under ThreadSanitizer too (PICOEVENTS_SANITIZE_THREAD).
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "picoevents_executor.h"
+#include "check.h"
+
+namespace
+{
+	const size_t producers = 4;
+	const size_t perProducer = 2000;
+	// each posted task posts children from its worker, and one in three a main task
+	const size_t children = 3;
+	const size_t tasks = producers * perProducer * (1 + children);
+	const size_t mainTasks = (producers * perProducer + 2) / 3;
+
+	void everyTaskRunsOnce(picoevents::Executor::Idle idle)
+	{
+		std::unique_ptr<std::atomic<int>[]> runs(new std::atomic<int>[tasks]);
+		for (size_t i = 0; i < tasks; i++) runs[i].store(0);
+		std::atomic<size_t> mainPosted { 0 };
+		size_t mainRun = 0;
+		{
+			picoevents::Executor executor(4, idle);
+			std::vector<std::thread> threads;
+			for (size_t p = 0; p < producers; p++)
+			{
+				threads.emplace_back([&, p] {
+					for (size_t i = 0; i < perProducer; i++)
+					{
+						size_t posted = p * perProducer + i;
+						size_t id = posted * (1 + children);
+						executor.post([&, posted, id] {
+							runs[id]++;
+							for (size_t c = 1; c <= children; c++)
+							{
+								executor.post([&runs, id, c] { runs[id + c]++; });
+							}
+							if (posted % 3 == 0)
+							{
+								mainPosted++;
+								executor.postMain([&mainRun] { mainRun++; });
+							}
+						});
+					}
+				});
+			}
+			for (auto& t : threads) t.join();
+			// the main tasks are only run by runMain(), while the workers still post them
+			while (mainRun < mainTasks)
+			{
+				if (!executor.runMain()) std::this_thread::yield();
+			}
+		}
+		CHECK(mainRun == mainTasks && mainPosted.load() == mainTasks);
+		for (size_t i = 0; i < tasks; i++) CHECK(runs[i].load() == 1);
+	}
+}
+
+int main()
+{
+	everyTaskRunsOnce(picoevents::Executor::Idle::Park);
+	everyTaskRunsOnce(picoevents::Executor::Idle::Yield);
+	everyTaskRunsOnce(picoevents::Executor::Idle::Spin);
+	return 0;
+}
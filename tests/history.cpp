@@ -0,0 +1,219 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// History: undo / redo of Values, a new change dropping the redo branch, the
+// step limit, transactions, listeners notified once per value and step, and
+// PersistentVector values (persistence checked against std::vector copies).
+
+#include <random>
+#include <vector>
+
+#include "picoevents.h"
+#include "picoevents_persistent.h"
+#include "check.h"
+
+namespace
+{
+	void undoRedoNotifies()
+	{
+		picoevents::History history;
+		picoevents::Value<int> value(0);
+		value.enableHistory(history);
+		std::vector<int> seen;
+		value.addListener([&seen](int v) { seen.push_back(v); });
+
+		value.set(1);
+		value.set(2);
+		CHECK(history.canUndo() && !history.canRedo());
+		seen.clear();
+		CHECK(history.undo());
+		CHECK(value.get() == 1);
+		CHECK(history.undo());
+		CHECK(value.get() == 0 && !history.canUndo());
+		CHECK(!history.undo());
+		CHECK(history.redo());
+		CHECK(value.get() == 1 && history.canRedo());
+		CHECK((seen == std::vector<int> { 1, 0, 1 }));
+	}
+
+	void newChangeDropsTheRedoBranch()
+	{
+		picoevents::History history;
+		picoevents::Value<int> value(0);
+		value.enableHistory(history);
+		value.set(1);
+		value.set(2);
+		value.set(3);
+		history.undo();
+		history.undo();
+		CHECK(value.get() == 1 && history.canRedo());
+
+		value.set(10);
+		CHECK(!history.canRedo());
+		CHECK(!history.redo());
+		history.undo();
+		CHECK(value.get() == 1);
+		history.redo();
+		CHECK(value.get() == 10);
+		history.undo();
+		history.undo();
+		CHECK(value.get() == 0 && !history.canUndo());
+	}
+
+	void stepLimit()
+	{
+		picoevents::History history(3);
+		picoevents::Value<int> value(0);
+		value.enableHistory(history);
+		for (int i = 1; i <= 5; i++) value.set(i);
+		int undos = 0;
+		while (history.undo()) undos++;
+		CHECK(undos == 3 && value.get() == 2);
+
+		while (history.redo()) {}
+		CHECK(value.get() == 5);
+		history.setMaxSteps(1);
+		CHECK(history.getMaxSteps() == 1);
+		CHECK(history.undo() && !history.undo());
+		CHECK(value.get() == 4);
+	}
+
+	void transactionsAndForget()
+	{
+		picoevents::History history;
+		picoevents::Value<int> a(0), b(0);
+		a.enableHistory(history);
+		b.enableHistory(history);
+		int aCalls = 0, bCalls = 0;
+		a.addListener([&aCalls](int) { aCalls++; });
+		b.addListener([&bCalls](int) { bCalls++; });
+		{
+			picoevents::History::ScopedTransaction transaction(history);
+			a.set(1);
+			a.set(2);
+			b.set(3);
+		}
+		aCalls = bCalls = 0;
+		// one step, each value restored (and notified) once
+		CHECK(history.undo());
+		CHECK(a.get() == 0 && b.get() == 0 && aCalls == 1 && bCalls == 1);
+		CHECK(!history.canUndo());
+		history.redo();
+		CHECK(a.get() == 2 && b.get() == 3);
+
+		// deleting a value drops its changes, and the steps left empty
+		{
+			picoevents::Value<int> gone(0);
+			gone.enableHistory(history);
+			gone.set(1);
+			gone.set(2);
+		}
+		CHECK(history.undo());
+		CHECK(a.get() == 0 && b.get() == 0 && !history.canUndo());
+	}
+
+	void listenersDontRecordWhileReplaying()
+	{
+		picoevents::History history;
+		picoevents::Value<int> source(0), derived(0);
+		source.enableHistory(history);
+		derived.enableHistory(history);
+		source.addListener([&derived](int v) { derived.set(v * 2); });
+		source.set(1);
+		CHECK(derived.get() == 2);
+		// source's step, then derived's step
+		history.undo();
+		CHECK(source.get() == 1 && derived.get() == 0);
+		history.undo();
+		// the listener set derived again while replaying: not a new step
+		CHECK(source.get() == 0 && derived.get() == 0);
+		CHECK(!history.canUndo());
+		history.redo();
+		history.redo();
+		CHECK(source.get() == 1 && derived.get() == 2);
+	}
+
+	void persistentVectors()
+	{
+		std::mt19937 random(51);
+		picoevents::PersistentVector<int> v;
+		std::vector<int> model;
+		// earlier versions are left untouched by the later edits
+		std::vector<std::pair<picoevents::PersistentVector<int>, std::vector<int>>> versions;
+		for (int i = 0; i < 5000; i++)
+		{
+			int op = random() % 10;
+			if (op < 6 || model.empty())
+			{
+				v = v.push_back(i);
+				model.push_back(i);
+			}
+			else if (op < 8)
+			{
+				size_t at = random() % model.size();
+				v = v.set(at, -i);
+				model[at] = -i;
+			}
+			else
+			{
+				v = v.pop_back();
+				model.pop_back();
+			}
+			if (i % 250 == 0) versions.emplace_back(v, model);
+		}
+		CHECK(v.toVector() == model);
+		for (auto& version : versions) CHECK(version.first.toVector() == version.second);
+
+		picoevents::History history;
+		picoevents::Value<picoevents::PersistentVector<int>> rows(v);
+		rows.enableHistory(history);
+		int calls = 0;
+		rows.addListener([&calls](const picoevents::PersistentVector<int>&) { calls++; });
+		picoevents::PersistentVector<int> before = rows.get();
+		rows.set(rows.get().set(1, 42));
+		rows.set(rows.get().push_back(7));
+		CHECK(rows.get()[1] == 42 && rows.get().back() == 7);
+		history.undo();
+		history.undo();
+		// the same tree as before, not a copy of it
+		CHECK(rows.get().sharesWith(before));
+		CHECK(calls == 4);
+		history.redo();
+		CHECK(rows.get()[1] == 42 && rows.get().size() == before.size());
+	}
+}
+
+int main()
+{
+	undoRedoNotifies();
+	newChangeDropsTheRedoBranch();
+	stepLimit();
+	transactionsAndForget();
+	listenersDontRecordWhileReplaying();
+	persistentVectors();
+	return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// InlineEvent never allocates: add, remove, notify, muting, ScopedCallbackID,
+// ScopedDisable, callbacks added and removed while notifying and overflows are
+// checked under the counting operator new of picoevents_allocations.h, after
+// the behaviour they share with Event.
+
+#undef NDEBUG
+
+#include <cstdio>
+#include <functional>
+
+#include "picoevents_inline.h"
+#include "allocation_counter.h"
+
+namespace
+{
+	int order[8] = {};
+	int calls = 0;
+	size_t overflows = 0;
+	void onOverflow(size_t capacity)
+	{
+		CHECK(capacity == 4);
+		overflows++;
+	}
+}
+
+int main()
+{
+	checkAllocationCounter();
+	picoevents::InlineEventBase::setOverflowHandler(&onOverflow);
+
+	picoevents::InlineEvent<4, int> e;
+	auto log = [](int tag) { return [tag](int) { order[calls++] = tag; }; };
+
+	// order, add first, mute, remove
+	{
+		picoevents::ScopedAllocationBudget budget("InlineEvent add / remove / notify", 0);
+		auto a = e.add(log(1));
+		auto b = e.add(log(2));
+		auto c = e.add(log(3), true);
+		e.notify(0);
+		CHECK(calls == 3 && order[0] == 3 && order[1] == 1 && order[2] == 2);
+		e.setMuted(a, true);
+		calls = 0;
+		e.notify(0);
+		CHECK(calls == 2 && order[0] == 3 && order[1] == 2 && e.isMuted(a));
+		e.remove(b);
+		CHECK(!e.isValid(b) && e.size() == 2);
+		e.remove(a);
+		e.remove(c);
+		CHECK(e.size() == 0);
+	}
+
+	// overflow: an invalid id and the handler, nothing allocated
+	{
+		picoevents::ScopedAllocationBudget budget("InlineEvent overflow", 0);
+		picoevents::SubscriptionID ids[4];
+		for (auto& id : ids) id = e.add([](int) {});
+		auto extra = e.add([](int) {});
+		CHECK(!e.isValid(extra) && overflows == 1);
+		for (auto& id : ids) e.remove(id);
+	}
+
+	// changes made by the callbacks while notifying
+	{
+		picoevents::ScopedAllocationBudget budget("InlineEvent changes while notifying", 0);
+		picoevents::SubscriptionID self, added;
+		calls = 0;
+		self = e.add([&e, &self, &added](int) { calls++; e.remove(self); added = e.add([](int) { order[calls++] = 7; }, true); });
+		e.notify(0);
+		CHECK(calls == 1 && !e.isValid(self) && e.isValid(added) && e.size() == 1);
+		calls = 0;
+		e.notify(0);
+		CHECK(calls == 1 && order[0] == 7);
+		e.remove(added);
+	}
+
+	// scoped helpers
+	{
+		picoevents::ScopedAllocationBudget budget("InlineEvent scoped helpers", 0);
+		calls = 0;
+		{
+			picoevents::InlineEvent<4, int>::ScopedCallbackID scoped(e, log(5));
+			CHECK(scoped.isValid());
+			{
+				picoevents::InlineEvent<4, int>::ScopedDisable disable(e);
+				e.notify(0);
+			}
+			e.notify(0);
+		}
+		e.notify(0);
+		CHECK(calls == 1 && e.size() == 0);
+	}
+
+	// the steady state, with a place left for add()
+	for (int i = 0; i < 3; i++) e.add(log(i));
+	checkNoAllocations("InlineEvent<4, int>::notify", [&] { calls = 0; e.notify(1); });
+	checkNoAllocations("InlineEvent<4, int> add + remove", [&]
+	{
+		picoevents::SubscriptionID id = e.add(log(9), true);
+		e.remove(id);
+	});
+	CHECK(overflows == 1);
+
+	// a std::function fits whatever the standard library (it may allocate by itself)
+	static_assert(sizeof(std::function<void(int)>) <= picoevents::InlineEvent<4, int>::CallableSize, "");
+	static_assert(4 * sizeof(void*) <= picoevents::InlineEvent<4, int>::CallableSize, "");
+	{
+		picoevents::InlineEvent<1, int> f;
+		int got = 0;
+		CHECK(f.isValid(f.add(std::function<void(int)>([&got](int i) { got = i; }))));
+		f.notify(5);
+		CHECK(got == 5);
+	}
+
+	printf("%d calls\n", calls);
+	return 0;
+}
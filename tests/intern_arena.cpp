@@ -0,0 +1,143 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// InternArena: payloads don't move as the arena grows, equal payloads intern to
+// the same handle (across the rehashes of the index too), and the handles made
+// before a clear() resolve to nullptr, even once the arena is refilled.
+
+#include <string>
+#include <vector>
+
+#include "picoevents.h"
+#include "picoevents_intern.h"
+#include "check.h"
+
+namespace
+{
+	using Paths = picoevents::InternArena<std::string>;
+
+	std::string path(int i)
+	{
+		return "/a/path/long/enough/not/to/be/stored/inline/" + std::to_string(i);
+	}
+
+	void stableAcrossGrowth()
+	{
+		Paths paths;
+		std::vector<Paths::Handle> handles;
+		std::vector<const std::string*> addresses;
+		// several chunks, and several rehashes of the index
+		for (int i = 0; i < 3000; i++)
+		{
+			handles.push_back(paths.intern(path(i)));
+			addresses.push_back(paths.resolve(handles.back()));
+		}
+		CHECK(paths.size() == 3000);
+		for (int i = 0; i < 3000; i++)
+		{
+			CHECK(paths.resolve(handles[i]) == addresses[i]);
+			CHECK(*addresses[i] == path(i));
+		}
+	}
+
+	void equalPayloadsEqualHandles()
+	{
+		Paths paths;
+		std::vector<Paths::Handle> handles;
+		for (int i = 0; i < 1000; i++) handles.push_back(paths.intern(path(i)));
+		for (int i = 999; i >= 0; i--) CHECK(paths.intern(path(i)) == handles[i]);
+		CHECK(paths.size() == 1000);
+		CHECK(handles[1] != handles[2]);
+
+		// store() doesn't look for an equal payload
+		Paths::Handle stored = paths.store(path(1));
+		CHECK(stored != handles[1] && paths.size() == 1001);
+		CHECK(*paths.resolve(stored) == *paths.resolve(handles[1]));
+		CHECK(paths.intern(path(1)) == handles[1]);
+	}
+
+	void staleHandles()
+	{
+		Paths paths;
+		CHECK(!paths.resolve(Paths::Handle()));
+		Paths::Handle old = paths.intern(path(0));
+		Paths::Handle oldSecond = paths.intern(path(1));
+		paths.clear();
+		CHECK(paths.size() == 0);
+		CHECK(!paths.resolve(old) && !paths.resolve(oldSecond));
+
+		// refilled: the same positions hold new payloads, the old handles stay stale
+		Paths::Handle now = paths.intern(path(1));
+		paths.intern(path(2));
+		CHECK(*paths.resolve(now) == path(1));
+		CHECK(now != oldSecond);
+		CHECK(!paths.resolve(old) && !paths.resolve(oldSecond));
+
+		// callbacks wrapped by resolving() skip the stale ones
+		picoevents::Event<Paths::Handle> opened;
+		std::vector<std::string> seen;
+		opened.add(paths.resolving([&seen](const std::string& p) { seen.push_back(p); }));
+		opened.notify(old);
+		opened.notify(now);
+		opened.notify(Paths::Handle());
+		CHECK((seen == std::vector<std::string> { path(1) }));
+	}
+
+	struct Counted
+	{
+		static int live;
+		int value;
+		Counted(int v) : value(v) { live++; }
+		Counted(const Counted& other) : value(other.value) { live++; }
+		Counted(Counted&& other) noexcept : value(other.value) { live++; }
+		~Counted() { live--; }
+	};
+	int Counted::live = 0;
+
+	void destroysPayloads()
+	{
+		{
+			picoevents::InternArena<Counted> arena;
+			for (int i = 0; i < 600; i++) arena.store(Counted(i));
+			CHECK(Counted::live == 600);
+			arena.clear();
+			CHECK(Counted::live == 0);
+			for (int i = 0; i < 10; i++) arena.store(Counted(i));
+			CHECK(Counted::live == 10);
+		}
+		CHECK(Counted::live == 0);
+	}
+}
+
+int main()
+{
+	stableAcrossGrowth();
+	equalPayloadsEqualHandles();
+	staleHandles();
+	destroysPayloads();
+	return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Moving callbacks to another event (Event::moveTo, ScopedCallbackID::retarget,
+// ScopedCallbacksHolder::retargetCallbacks), including to an event that refuses
+// them: an event with move-only arguments already having its callback.
+// Refusing asserts in debug builds, so this test is built without assert().
+
+#if !defined(NDEBUG)
+#define NDEBUG
+#endif
+
+#include <memory>
+
+#include "picoevents.h"
+#include "check.h"
+
+namespace
+{
+	using Payload = std::unique_ptr<int>;
+	using PayloadEvent = picoevents::Event<Payload>;
+
+	struct Panel : picoevents::ScopedCallbacksHolder
+	{
+		int calls = 0;
+	};
+
+	void retargetsToAnotherEvent()
+	{
+		picoevents::Event<int> a, b;
+		int calls = 0;
+		{
+			picoevents::Event<int>::ScopedCallbackID scoped(a, [&calls](int v) { calls += v; });
+			CHECK(scoped.retarget(b));
+			CHECK(&scoped.getEvent() == &b);
+			a.notify(1);
+			b.notify(10);
+			CHECK(calls == 10);
+		}
+		b.notify(100);
+		CHECK(calls == 10);
+
+		Panel panel;
+		panel.addCallback(a, [&panel](int) { panel.calls++; });
+		panel.addCallback(a, [&panel](int) { panel.calls++; });
+		CHECK(panel.retargetCallbacks(a, b) == 2);
+		b.notify(0);
+		a.notify(0);
+		CHECK(panel.calls == 2);
+	}
+
+	void refusedRetargetKeepsTheCallback()
+	{
+		PayloadEvent source, target;
+		int targetCalls = 0;
+		target.add([&targetCalls](Payload) { targetCalls++; });
+		int calls = 0;
+		{
+			PayloadEvent::ScopedCallbackID scoped(source, [&calls](Payload p) { calls += *p; });
+			CHECK(!scoped.retarget(target));
+			CHECK(&scoped.getEvent() == &source);
+			source.notify(std::make_unique<int>(1));
+			CHECK(calls == 1);
+		}
+		// the scoped callback removed its callback from source
+		source.notify(std::make_unique<int>(1));
+		CHECK(calls == 1 && targetCalls == 0);
+		target.notify(std::make_unique<int>(1));
+		CHECK(targetCalls == 1);
+	}
+
+	void refusedRetargetCallbacksKeepsThem()
+	{
+		PayloadEvent source, target;
+		target.add([](Payload) {});
+		{
+			Panel panel;
+			panel.addCallback(source, [&panel](Payload) { panel.calls++; });
+			CHECK(panel.retargetCallbacks(source, target) == 0);
+			source.notify(std::make_unique<int>(1));
+			CHECK(panel.calls == 1);
+		}
+		// the panel is gone: calling its callback would use it after its scope
+		source.notify(std::make_unique<int>(1));
+	}
+}
+
+int main()
+{
+	retargetsToAnotherEvent();
+	refusedRetargetKeepsTheCallback();
+	refusedRetargetCallbacksKeepsThem();
+	return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Notifier: triggered again with the same arguments when they are copyable,
+// triggered once, moving them, when they are move-only (ScopedNotifier too).
+// notifier_lvalue_move_only.cpp must not compile, see CMakeLists.txt.
+
+#include <memory>
+#include <string>
+
+#include "picoevents.h"
+#include "check.h"
+
+namespace
+{
+	void copyableTriggersAgain()
+	{
+		picoevents::Event<int, std::string> event;
+		int calls = 0;
+		std::string last;
+		event.add([&](int, const std::string& s) { calls++; last = s; });
+		event.add([&](int i, std::string s) { calls += i; last += s; });
+
+		auto notifier = event.makeNotifier(10, "a string long enough not to be stored inline");
+		notifier.trigger();
+		CHECK(calls == 11);
+		last.clear();
+		// the arguments weren't moved out of the notifier
+		notifier.trigger();
+		CHECK(calls == 22);
+		CHECK(last == "a string long enough not to be stored inlinea string long enough not to be stored inline");
+		std::move(notifier).trigger();
+		CHECK(calls == 33);
+	}
+
+	void moveOnlyTriggersOnce()
+	{
+		picoevents::Event<std::unique_ptr<int>> event;
+		std::unique_ptr<int> received;
+		event.add([&received](std::unique_ptr<int> p) { received = std::move(p); });
+
+		auto notifier = event.makeNotifier(std::make_unique<int>(1));
+		std::move(notifier).trigger();
+		CHECK(received && *received == 1);
+
+		{
+			picoevents::Event<std::unique_ptr<int>>::ScopedNotifier scoped(event, std::make_unique<int>(2));
+			CHECK(*received == 1);
+		}
+		CHECK(received && *received == 2);
+	}
+}
+
+int main()
+{
+	copyableTriggersAgain();
+	moveOnlyTriggersOnce();
+	return 0;
+}
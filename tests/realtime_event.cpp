@@ -0,0 +1,208 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// RealtimeEvent::notify on a real-time thread while another thread adds, mutes
+// and removes callbacks: notify must not allocate or free (the counting operator
+// new of picoevents_allocations.h and, on glibc without a sanitizer, malloc) nor
+// lock a mutex (pthread_mutex_lock interposed on glibc). Also reports its mean and
+// worst-case latency.
+
+#undef NDEBUG
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+#include "picoevents_realtime.h"
+#include "allocation_counter.h"
+
+#if defined(__GLIBC__)
+#include <dlfcn.h>
+#include <pthread.h>
+#define INTERPOSE_MUTEX
+// the sanitizers replace malloc themselves
+#if !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+#define INTERPOSE_MALLOC
+#endif
+#endif
+
+namespace
+{
+	// made by the current thread, counted by the functions below
+	thread_local size_t mutexLocks = 0;
+	thread_local size_t mallocs = 0;
+	thread_local size_t frees = 0;
+}
+
+#if defined(INTERPOSE_MUTEX)
+namespace
+{
+	using LockFunction = int (*)(pthread_mutex_t*);
+	LockFunction next(std::atomic<LockFunction>& f, const char* name)
+	{
+		LockFunction res = f.load(std::memory_order_acquire);
+		if (!res)
+		{
+			res = reinterpret_cast<LockFunction>(dlsym(RTLD_NEXT, name));
+			f.store(res, std::memory_order_release);
+		}
+		return res;
+	}
+	std::atomic<LockFunction> nextLock { nullptr };
+	std::atomic<LockFunction> nextTryLock { nullptr };
+}
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t* m) noexcept
+{
+	mutexLocks++;
+	return next(nextLock, "pthread_mutex_lock")(m);
+}
+extern "C" int pthread_mutex_trylock(pthread_mutex_t* m) noexcept
+{
+	mutexLocks++;
+	return next(nextTryLock, "pthread_mutex_trylock")(m);
+}
+#endif
+
+#if defined(INTERPOSE_MALLOC)
+extern "C"
+{
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t n, size_t size);
+	void* __libc_realloc(void* p, size_t size);
+	void __libc_free(void* p);
+
+	void* malloc(size_t size) noexcept
+	{
+		mallocs++;
+		return __libc_malloc(size);
+	}
+	void* calloc(size_t n, size_t size) noexcept
+	{
+		mallocs++;
+		return __libc_calloc(n, size);
+	}
+	void* realloc(void* p, size_t size) noexcept
+	{
+		mallocs++;
+		return __libc_realloc(p, size);
+	}
+	void free(void* p) noexcept
+	{
+		if (p) frees++;
+		__libc_free(p);
+	}
+}
+#endif
+
+int main()
+{
+	checkAllocationCounter();
+#if defined(INTERPOSE_MUTEX)
+	{
+		std::mutex m;
+		size_t before = mutexLocks;
+		m.lock();
+		m.unlock();
+		CHECK(mutexLocks == before + 1);
+	}
+#endif
+#if defined(INTERPOSE_MALLOC)
+	{
+		size_t before = mallocs;
+		void* volatile p = std::malloc(16);
+		std::free(p);
+		CHECK(mallocs == before + 1);
+	}
+#endif
+
+	using Clock = std::chrono::steady_clock;
+	picoevents::RealtimeEvent<16, int> block;
+	long sum = 0;		// only touched by the real-time thread
+	for (int i = 0; i < 8; i++) block.add([&sum, i](int v) { sum += v + i; });
+
+	struct Result
+	{
+		picoevents::AllocationCounter::Counts counts;
+		size_t mutexLocks = 0;
+		size_t mallocs = 0;
+		size_t frees = 0;
+		Clock::duration total {};
+		Clock::duration worst {};
+	} result;
+	std::atomic<size_t> notifications { 0 };
+	std::atomic<bool> stop { false };
+
+	std::thread realtime([&]
+	{
+		// the first notify() takes the initial callbacks
+		block.notify(0);
+		picoevents::ScopedAllocationCount count;
+		size_t locks = mutexLocks, allocated = mallocs, freed = frees;
+		while (!stop.load(std::memory_order_acquire))
+		{
+			Clock::time_point start = Clock::now();
+			block.notify(1);
+			Clock::duration d = Clock::now() - start;
+			result.total += d;
+			result.worst = std::max(result.worst, d);
+			notifications.fetch_add(1, std::memory_order_release);
+		}
+		result.counts = count.get();
+		result.mutexLocks = mutexLocks - locks;
+		result.mallocs = mallocs - allocated;
+		result.frees = frees - freed;
+	});
+
+	// the changes notify() applies and hands back, made from this thread
+	for (int i = 0; i < 2000; i++)
+	{
+		picoevents::SubscriptionID id = block.add([&sum](int v) { sum -= v; }, i % 2 == 0);
+		block.setMuted(id, true);
+		block.remove(id);
+		if (i % 64 == 0) std::this_thread::yield();
+	}
+	while (notifications.load(std::memory_order_acquire) < 10000) std::this_thread::yield();
+	stop.store(true, std::memory_order_release);
+	realtime.join();
+	block.collect();
+
+	size_t n = notifications.load();
+	printf("RealtimeEvent<16, int>::notify: %zu calls, mean %.3f us, worst %.3f us\n", n,
+		std::chrono::duration<double, std::micro>(result.total).count() / double(n),
+		std::chrono::duration<double, std::micro>(result.worst).count());
+	printf("allocations %zu, frees %zu, malloc %zu, free %zu, mutex locks %zu (sum %ld)\n",
+		result.counts.allocations, result.counts.frees, result.mallocs, result.frees, result.mutexLocks, sum);
+	CHECK(result.counts.allocations == 0 && result.counts.frees == 0);
+	CHECK(result.mallocs == 0 && result.frees == 0);
+	CHECK(result.mutexLocks == 0);
+	return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// SharedValue with readers and writers on several threads: the seqlock
+// (trivially copyable types) and the read-copy-update storage (the others)
+// never return a torn value, and the versions replaced by set() are deleted
+// once no reader can see them anymore, counted by their destructions.
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "picoevents_shared.h"
+#include "check.h"
+
+namespace
+{
+	const int writers = 2;
+	const int readers = 3;
+	const uint64_t sets = 20000;
+
+	// written as a whole: a torn read sees different words
+	struct Words
+	{
+		uint64_t w[4];
+	};
+
+	struct Tracked
+	{
+		static std::atomic<long> live;
+		std::vector<uint64_t> words;
+
+		explicit Tracked(uint64_t v) : words(8, v) { live++; }
+		Tracked(const Tracked& other) : words(other.words) { live++; }
+		~Tracked() { live--; }
+		bool consistent() const
+		{
+			for (uint64_t w : words)
+			{
+				if (w != words[0]) return false;
+			}
+			return words.size() == 8;
+		}
+	};
+	std::atomic<long> Tracked::live { 0 };
+
+	// each writer sets the values it owns (i * writers + writer), the readers
+	// check every value they see; values only grow per writer, not overall
+	template<typename T, typename Make, typename Check>
+	void readersAndWriters(picoevents::SharedValue<T>& value, Make make, Check check)
+	{
+		std::atomic<bool> writing { true };
+		std::atomic<bool> failed { false };
+		std::vector<std::thread> threads;
+		for (int r = 0; r < readers; r++)
+		{
+			threads.emplace_back([&] {
+				while (writing.load())
+				{
+					if (!value.read([&check](const T& t) { return check(t); })) failed = true;
+					if (!check(value.get())) failed = true;
+				}
+			});
+		}
+		std::vector<std::thread> setters;
+		for (int w = 0; w < writers; w++)
+		{
+			setters.emplace_back([&value, &make, w] {
+				for (uint64_t i = 1; i <= sets; i++) value.set(make(i * writers + w));
+			});
+		}
+		for (auto& t : setters) t.join();
+		writing = false;
+		for (auto& t : threads) t.join();
+		CHECK(!failed.load());
+		CHECK(value.version() == writers * sets);
+	}
+
+	void seqlockNeverTorn()
+	{
+		picoevents::SharedValue<Words> value(Words { { 0, 0, 0, 0 } });
+		readersAndWriters(value,
+			[](uint64_t v) { return Words { { v, v, v, v } }; },
+			[](const Words& w) { return w.w[0] == w.w[1] && w.w[1] == w.w[2] && w.w[2] == w.w[3]; });
+	}
+
+	void rcuNeverTornAndReclaimed()
+	{
+		{
+			picoevents::SharedValue<Tracked> value(Tracked(0));
+			readersAndWriters(value,
+				[](uint64_t v) { return Tracked(v); },
+				[](const Tracked& t) { return t.consistent(); });
+			// nobody reads anymore: the next set() deletes everything it retired
+			value.set(Tracked(1));
+			CHECK(Tracked::live == 1);
+
+			// a reader holding a version keeps it, and the ones replaced after it
+			std::atomic<int> state { 0 };
+			std::thread reader([&] {
+				value.read([&state](const Tracked& t) {
+					state = 1;
+					while (state.load() != 2) std::this_thread::yield();
+					CHECK(t.consistent() && t.words[0] == 1);
+					return 0;
+				});
+			});
+			while (state.load() != 1) std::this_thread::yield();
+			for (uint64_t v = 2; v < 10; v++) value.set(Tracked(v));
+			CHECK(Tracked::live == 9);
+			state = 2;
+			reader.join();
+			value.set(Tracked(10));
+			CHECK(Tracked::live == 1);
+			CHECK(value.get().words[0] == 10);
+		}
+		CHECK(Tracked::live == 0);
+	}
+}
+
+int main()
+{
+	seqlockNeverTorn();
+	rcuNeverTornAndReclaimed();
+	return 0;
+}
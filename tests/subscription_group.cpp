@@ -0,0 +1,178 @@
+/*
+ * Copyright 2019 Patrice Tarabbia
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// SubscriptionGroup: everything removed when the group goes, other callbacks kept,
+// mute / unmute of the whole group (callbacks added meanwhile included), and the
+// events destroyed before the group, or after it, or after it was moved.
+
+#include <memory>
+#include <vector>
+
+#include "picoevents.h"
+#include "check.h"
+
+namespace
+{
+	void destructionRemovesEverything()
+	{
+		picoevents::Event<int> a;
+		picoevents::Event<> b;
+		int calls = 0;
+		a.add([&calls](int) { calls += 100; });	// not in the group
+		{
+			picoevents::SubscriptionGroup group;
+			// enough to go through prune()
+			for (int i = 0; i < 40; i++) group.add(a, [&calls](int) { calls++; });
+			group.add(b, [&calls]() { calls++; });
+			auto removed = group.add(a, [&calls](int) { calls++; });
+			a.remove(removed);
+			CHECK(group.size() == 41);
+			a.notify(0);
+			b.notify();
+			CHECK(calls == 141);
+		}
+		calls = 0;
+		a.notify(0);
+		b.notify();
+		CHECK(calls == 100);
+	}
+
+	void muteTheWholeGroup()
+	{
+		picoevents::Event<int> a;
+		picoevents::Event<> b;
+		int calls = 0;
+		picoevents::SubscriptionGroup group;
+		group.add(a, [&calls](int) { calls++; });
+		group.add(b, [&calls]() { calls++; });
+		auto own = a.add([&calls](int) { calls += 100; });
+
+		group.setMuted(true);
+		CHECK(group.isMuted());
+		a.notify(0);
+		b.notify();
+		CHECK(calls == 100);
+		// added while muted: muted too
+		auto late = group.add(a, [&calls](int) { calls++; });
+		CHECK(a.isMuted(late) && !a.isMuted(own));
+		a.notify(0);
+		CHECK(calls == 200);
+
+		group.setMuted(false);
+		calls = 0;
+		a.notify(0);
+		b.notify();
+		CHECK(calls == 103);
+		group.removeAll();
+		CHECK(group.size() == 0);
+		calls = 0;
+		a.notify(0);
+		b.notify();
+		CHECK(calls == 100);
+	}
+
+	void eventDestroyedFirst()
+	{
+		int calls = 0;
+		picoevents::Event<int> kept;
+		picoevents::SubscriptionGroup group;
+		auto gone = std::make_unique<picoevents::Event<int>>();
+		group.add(*gone, [&calls](int) { calls++; });
+		group.add(kept, [&calls](int) { calls++; });
+		group.add(*gone, [&calls](int) { calls++; });
+		CHECK(group.size() == 3);
+		gone.reset();
+		CHECK(group.size() == 1);
+		group.setMuted(true);
+		kept.notify(0);
+		CHECK(calls == 0);
+		group.setMuted(false);
+
+		// a new event, maybe at the same address, is not mistaken for the old one
+		auto next = std::make_unique<picoevents::Event<int>>();
+		group.add(*next, [&calls](int) { calls++; });
+		CHECK(group.size() == 2);
+		next->notify(0);
+		CHECK(calls == 1);
+
+		// many short lived events: prune() drops them
+		for (int i = 0; i < 100; i++)
+		{
+			picoevents::Event<int> temporary;
+			group.add(temporary, [](int) {});
+		}
+		CHECK(group.size() == 2);
+
+		// moved: the events left later still find the group
+		picoevents::SubscriptionGroup moved(std::move(group));
+		CHECK(group.size() == 0 && moved.size() == 2);
+		next.reset();
+		CHECK(moved.size() == 1);
+		moved.removeAll();
+		calls = 0;
+		kept.notify(0);
+		CHECK(calls == 0);
+	}
+
+	void groupDestroyedFirst()
+	{
+		// the events must not keep a link to a destroyed group
+		int calls = 0;
+		picoevents::Event<int> a;
+		{
+			picoevents::SubscriptionGroup group;
+			group.add(a, [&calls](int) { calls++; });
+		}
+		{
+			picoevents::SubscriptionGroup first, second;
+			first.add(a, [&calls](int) { calls++; });
+			second.add(a, [&calls](int) { calls++; });
+			first.removeAll();
+			CHECK(second.size() == 1);
+		}
+		a.notify(0);
+		CHECK(calls == 0);
+		// a copy of an event is not in the groups of the original
+		picoevents::SubscriptionGroup group;
+		group.add(a, [&calls](int) { calls++; });
+		{
+			picoevents::Event<int> copy(a);
+			copy.notify(0);
+			CHECK(calls == 1);
+		}
+		CHECK(group.size() == 1);
+	}
+}
+
+int main()
+{
+	destructionRemovesEverything();
+	muteTheWholeGroup();
+	eventDestroyedFirst();
+	groupDestroyedFirst();
+	return 0;
+}